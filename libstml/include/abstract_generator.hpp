@@ -2,7 +2,12 @@
 #define ABSTRACT_GENERATOR_H_
 
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <vector>
+
+#include "output_index.hpp"
 
 namespace stml {
 
@@ -23,12 +28,155 @@ protected:
 
     std::ostream* out;
 
+    //Number of the threads decorating the lines; 0 if decorated in place.
+    unsigned int decoration_threads;
+    std::unique_ptr<DecorationPipeline> pipeline;
+
+    /**
+     * Decorates the markup and writes it to the output. In the pipelined
+     * mode the markup is copied and decorated on a worker thread.
+     */
+    void write_decorated(MarkupBuilder& markup, const TextDecoration& decoration);
+
+    /**
+     * Keeps the following output in memory until release_output(),
+     * so that something can be written before it.
+     */
+    void hold_output();
+
+    /**
+     * Writes the preface and then the output held since hold_output().
+     */
+    void release_output(const std::string& preface);
+
+    /**
+     * Starts an entry of the output index (if any) at the current position
+     * of the output. The entry ends at the position where end_index_entries()
+     * is called with the same or a lesser depth.
+     *
+     * @param	depth	depth of the tag stack before the element is opened.
+     */
+    inline void begin_index_entry(OutputIndex::EntryKinds kind, int level, size_t depth) {
+        if (indexing) {
+            add_index_entry(kind, level, depth);
+        }
+    }
+
+    /**
+     * Ends the open entries of the output index started at the depth or deeper.
+     */
+    inline void end_index_entries(size_t depth) {
+        if (indexing && !open_index_entries.empty()) {
+            close_index_entries(depth);
+        }
+    }
+
+    /**
+     * Appends the text to the innermost open header entry of the output index.
+     */
+    inline void append_index_text(const std::wstring& text) {
+        if (indexing) {
+            add_index_text(text);
+        }
+    }
+
+private:
+
+    struct IndexMarks {
+        size_t entry;
+        size_t depth;
+        size_t begin;
+        size_t end;
+    };
+
+    /**
+     * Range of the marks placed in the held output, which offsets are
+     * relative to the mark where the held output has been written.
+     */
+    struct HeldMarks {
+        size_t first;
+        size_t last;
+        size_t base;
+    };
+
+    //Where the output goes when it is not held.
+    std::ostream* destination;
+
+    //Output held since hold_output(); NULL if not held.
+    std::unique_ptr<std::ostringstream> held;
+    size_t first_held_mark;
+    std::vector<HeldMarks> held_marks;
+
+    //Bytes written to the destination by the finished pipelines.
+    size_t pipelines_written;
+
+    //Number of the first mark of the current pipeline.
+    size_t first_pipeline_mark;
+
+    OutputIndex* output_index;
+    unsigned int source_line;
+
+    //Whether the current output is indexed.
+    bool indexing;
+
+    //Counts the output written in place when the output is indexed.
+    std::unique_ptr<CountingBuffer> counting_buffer;
+    std::unique_ptr<std::ostream> counting_stream;
+
+    //Offsets of the marks in the output by their numbers.
+    std::vector<size_t> mark_offsets;
+
+    //Entries added for the current output; the open ones are at the end.
+    std::vector<IndexMarks> index_marks;
+    std::vector<size_t> open_index_entries;
+
+    size_t mark();
+    void start_pipeline(std::ostream& target);
+    void finish_pipeline();
+    void add_index_entry(OutputIndex::EntryKinds kind, int level, size_t depth);
+    void close_index_entries(size_t depth);
+    void add_index_text(const std::wstring& text);
+    void resolve_index_entries();
+
 public:
+    AbstractGenerator();
     virtual ~AbstractGenerator();
 
     void set_output(std::ostream* out);
     std::ostream* get_output() const;
 
+    /**
+     * Makes the generator decorate the lines (punctuation, hyphenation)
+     * with the specified number of threads while the document is being
+     * parsed. The output is the same. Takes effect on set_output().
+     *
+     * @param	threads	number of the threads; 0 to decorate the lines in place.
+     */
+    void set_decoration_threads(unsigned int threads);
+
+    /**
+     * Makes the generator add the positions of the headers, sections
+     * and top-level blocks in the output to the index. Takes effect
+     * on set_output().
+     *
+     * @param	index	the index; NULL not to index the output.
+     */
+    void set_output_index(OutputIndex* index);
+
+    /**
+     * Sets the line of the STML the following calls are made for.
+     */
+    inline void set_source_line(unsigned int line) {
+        source_line = line;
+    }
+
+    /**
+     * Writes the output of the lines which are still being decorated
+     * and completes the entries of the output index.
+     * Must be called after close_document().
+     */
+    void flush();
+
     /**
      * <doc> tag.
      */
@@ -155,6 +303,19 @@ public:
     virtual void line_continue() = 0;
     virtual void line_end() = 0;
     virtual void close_document() = 0;
+
+    /**
+     * Returns the variables of the generator.
+     */
+    virtual const VariablesManager& variables() const = 0;
+
+    /**
+     * Replaces the variables of the generator with a copy of the prototype.
+     * The copy shares the storage with the prototype until it changes.
+     *
+     * @param	prototype	variables of a generator of the same type.
+     */
+    virtual void set_variables(const VariablesManager& prototype) = 0;
 };
 
 /**
@@ -0,0 +1,174 @@
+#ifndef DECORATION_PIPELINE_HPP_
+#define DECORATION_PIPELINE_HPP_
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+
+#include "stml.hpp"
+#include "markup_builder.hpp"
+#include "languages/language.hpp"
+
+namespace stml {
+
+/**
+ * How the text of a line is decorated: the arguments of Language::decorate().
+ * The language and the typography must stay unchanged while the lines
+ * decorated with them are in a pipeline.
+ */
+struct TextDecoration {
+	const Language* language;
+	const Typography* typography;
+	HyphenationModes hyphenation;
+
+	void apply(MarkupBuilder& markup) const;
+};
+
+/**
+ * Decorates the lines of a document on worker threads while the document
+ * is being parsed. The generator writes its output to stream() and passes
+ * the lines to be decorated to submit(). The lines are decorated in batches,
+ * and the writer thread puts the batches to the output in the order they
+ * were submitted, so the output is the same as if the lines were decorated
+ * by the generator itself.
+ */
+class DecorationPipeline {
+	struct Line {
+		//Output of the generator preceding the line.
+		std::string prefix;
+
+		//Marks placed in the prefix, by their offsets in it.
+		std::vector<size_t> marks;
+		MarkupBuilder markup;
+		TextDecoration decoration;
+	};
+
+	struct Batch {
+		std::vector<Line> lines;
+		std::string output;
+
+		//Offsets of the marks of the lines in the output of the batch.
+		std::vector<size_t> marks;
+		bool done;
+		std::exception_ptr error;
+	};
+
+	typedef std::shared_ptr<Batch> BatchPtr;
+
+	static const size_t LINES_PER_BATCH = 32;
+
+	std::ostream* out;
+	std::ostringstream staged;
+	BatchPtr current;
+
+	//Marks placed in the staged output.
+	std::vector<size_t> staged_marks;
+	size_t marks_count;
+
+	//Offsets of the marks in the output, in the order they were placed.
+	//Filled by the writer thread.
+	std::vector<size_t> mark_offsets;
+
+	//Number of bytes written to the output. Filled by the writer thread.
+	size_t written_bytes;
+
+	//Number of batches being decorated or written, beyond which
+	//submit() waits for the writer.
+	size_t max_batches;
+
+	std::mutex state_mutex;
+	std::condition_variable batch_queued;
+	std::condition_variable batch_done;
+	std::condition_variable batch_written;
+
+	//Batches not taken by the workers yet.
+	std::deque<BatchPtr> queued;
+
+	//Batches not written yet, in the order of the document.
+	std::deque<BatchPtr> unwritten;
+
+	std::exception_ptr error;
+	bool stopping;
+
+	std::vector<std::thread> workers;
+	std::thread writer;
+
+	void dispatch();
+	void decorate_batches();
+	void write_batches();
+	void stop();
+
+	DecorationPipeline(const DecorationPipeline&);
+	DecorationPipeline& operator=(const DecorationPipeline&);
+
+public:
+
+	/**
+	 * Starts the threads.
+	 *
+	 * @param	out		where the document is written to.
+	 * @param	threads	number of the decoration workers.
+	 */
+	DecorationPipeline(std::ostream& out, unsigned int threads);
+
+	/**
+	 * Stops the threads. The output not dispatched to the workers is discarded.
+	 */
+	~DecorationPipeline();
+
+	/**
+	 * Returns the stream the output preceding the next line is written to.
+	 */
+	inline std::ostream& stream() {
+		return staged;
+	}
+
+	/**
+	 * Queues a copy of the markup to be decorated and written after
+	 * the output written to stream() so far.
+	 *
+	 * @throws	the exception a worker has failed with.
+	 */
+	void submit(const MarkupBuilder& markup, const TextDecoration& decoration);
+
+	/**
+	 * Places a mark at the end of the output written to stream() so far.
+	 * Its offset in the output is known when the output is written.
+	 *
+	 * @return	number of the mark, starting from 0.
+	 */
+	size_t mark();
+
+	/**
+	 * Returns the offsets of the marks in the output by their numbers.
+	 * Complete after finish().
+	 */
+	inline const std::vector<size_t>& marks() const {
+		return mark_offsets;
+	}
+
+	/**
+	 * Returns the number of bytes written to the output. Complete after finish().
+	 */
+	inline size_t written() const {
+		return written_bytes;
+	}
+
+	/**
+	 * Writes the rest of the output and waits for the threads to stop.
+	 *
+	 * @throws	the exception a worker has failed with.
+	 */
+	void finish();
+};
+
+}
+
+#endif /* DECORATION_PIPELINE_HPP_ */
@@ -0,0 +1,57 @@
+#ifndef DECORATION_TABLE_HPP_
+#define DECORATION_TABLE_HPP_
+
+#include <string>
+#include <stdint.h>
+
+namespace stml {
+
+typedef uint32_t decoration_id_t;
+
+/**
+ * Process-wide table of the strings the markup chars are decorated with
+ * (tags, entities, soft hyphens etc). Each distinct string is stored once
+ * and referred to by its ID; the IDs are never reused or invalidated.
+ */
+class DecorationTable {
+	//IDs are split into a chunk number and a position in the chunk.
+	static const decoration_id_t CHUNK_BITS = 12;
+	static const decoration_id_t CHUNK_SIZE = 1 << CHUNK_BITS;
+	static const decoration_id_t MAX_CHUNKS = 1 << 16;
+
+	static std::string* chunks[MAX_CHUNKS];
+
+public:
+
+	/**
+	 * ID which does not refer to any decoration.
+	 */
+	static const decoration_id_t NONE = 0;
+
+	/**
+	 * Greatest ID the table can issue.
+	 */
+	static const decoration_id_t MAX_ID = CHUNK_SIZE * MAX_CHUNKS - 1;
+
+	/**
+	 * Returns the ID of the string, adding it to the table if it is not
+	 * there yet. Safe to be called from several threads.
+	 *
+	 * @param str the decoration string.
+	 *
+	 * @return ID of the string.
+	 */
+	static decoration_id_t intern(const char* str);
+
+	/**
+	 * Returns the string by its ID. The ID must have been returned by intern().
+	 * Doesn't lock, so the decorations can be written from several threads.
+	 */
+	static inline const std::string& get(decoration_id_t id) {
+		return chunks[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)];
+	}
+};
+
+}
+
+#endif /* DECORATION_TABLE_HPP_ */
@@ -0,0 +1,72 @@
+#ifndef ESCAPE_TABLE_HPP_
+#define ESCAPE_TABLE_HPP_
+
+#include <cstddef>
+
+#include "decoration_table.hpp"
+
+namespace stml {
+
+/**
+ * Escape sequences of the special chars of an output format (e.g. "&amp;"
+ * for '&' in HTML). The text of a MarkupBuilder is escaped with the table
+ * when it is written out, rather than by decorating the special chars.
+ * Only ASCII chars can be special.
+ */
+class EscapeTable {
+public:
+
+	/**
+	 * Special char and its escape sequence.
+	 */
+	struct Escape {
+		wchar_t c;
+		const char* sequence;
+	};
+
+	static const size_t MAX_SPECIALS = 16;
+
+private:
+	static const size_t ASCII_SIZE = 128;
+
+	//Escape sequences by ASCII code; NULL if the char is not special.
+	const char* sequences[ASCII_SIZE];
+	decoration_id_t ids[ASCII_SIZE];
+
+	wchar_t specials[MAX_SPECIALS];
+	size_t specials_count;
+
+public:
+
+	/**
+	 * @param	escapes	the special chars and their escape sequences.
+	 * @param	count	number of the special chars; not more than MAX_SPECIALS.
+	 */
+	EscapeTable(const Escape* escapes, size_t count);
+
+	/**
+	 * Returns the escape sequence of the char, or NULL if it is not special.
+	 */
+	inline const char* sequence(wchar_t c) const {
+		return ((size_t)c < ASCII_SIZE) ? sequences[c] : NULL;
+	}
+
+	/**
+	 * Returns the escape sequence of the char as a decoration,
+	 * or DecorationTable::NONE if the char is not special.
+	 */
+	inline decoration_id_t id(wchar_t c) const {
+		return ((size_t)c < ASCII_SIZE) ? ids[c] : DecorationTable::NONE;
+	}
+
+	/**
+	 * Returns the position of the first special char of the text
+	 * starting at 'from', or 'length' if there are no special chars.
+	 * The text is scanned several chars at a time where SIMD is available.
+	 */
+	size_t find(const wchar_t* text, size_t from, size_t length) const;
+};
+
+}
+
+#endif /* ESCAPE_TABLE_HPP_ */
@@ -6,10 +6,12 @@
 #include <stack>
 #include <memory>
 #include <map>
+#include <deque>
+#include <unordered_map>
 
 #include "../../include/markup_builder.hpp"
 #include "../../include/languages/language.hpp"
-#include "../../include/languages/tokenizer.hpp"
+#include "../../include/decoration_pipeline.hpp"
 #include "../../include/variables_manager.hpp"
 #include "../../include/list_items_counter.hpp"
 #include "../../include/list_format.hpp"
@@ -17,8 +19,15 @@
 #define HTML_STRESS_MARK ("&acute;")
 #define HTML_DASH ("&mdash;")
 #define HTML_SHY ("&shy;")
+#define HTML_UTF8_STRESS_MARK ("\xCC\x81")
+#define HTML_UTF8_DASH ("\xE2\x80\x94")
+#define HTML_UTF8_SHY ("\xC2\xAD")
 #define CLASS_STRLEN (5)
 #define STYLE_STRLEN (5)
+#define HTML_BROWSER_HYPHENATION_CSS ("body{-webkit-hyphens:auto;hyphens:auto;}h1,h2,h3,h4,h5,h6,pre{-webkit-hyphens:manual;hyphens:manual;}")
+#define HTML_TOC_CSS ("#stml_toc ul{list-style:none;padding:0;}" \
+	".stml_toc_h2{padding-left:1em;}.stml_toc_h3{padding-left:2em;}.stml_toc_h4{padding-left:3em;}" \
+	".stml_toc_h5{padding-left:4em;}.stml_toc_h6{padding-left:5em;}")
 #define DEFAULT_LIST_FORMAT (L"#./.#./.#./.#./.#./.#.")
 
 namespace stml {
@@ -68,301 +77,27 @@ class HtmlGenerator: public AbstractGenerator {
 		TAG_RENDERERS_COUNT
 	};
 
-	class TagRenderer {
-	protected:
-		void write_attributes(
-			std::ostream& out,
-			const char* attr_names[],
-			const char* attr_values[],
-			size_t attr_count,
-			bool exclude_class,
-			bool exclude_style
-		);
-		void write_open(
-			HtmlGenerator* generator,
-			const char* tag_name,
-			const char* attr_names[],
-			const char* attr_values[],
-			size_t attr_count,
-			bool end,
-			bool close
-		);
-		void write_close(std::ostream& out, const char* tag_name);
-        const virtual char *tag_name() =0;
-        virtual var_id_t class_parameter(HtmlGenerator *generator) =0;
-        virtual var_id_t style_parameter(HtmlGenerator *generator) =0;
-        virtual const char *static_style() const;
-    public:
-        virtual void open(HtmlGenerator *generator, const char *attr_names[], const char *attr_values[], size_t attr_count, bool end, bool close);
-        virtual void line(HtmlGenerator *generator);
-        virtual void close(HtmlGenerator *generator);
-    };
-
-    typedef std::auto_ptr<TagRenderer> TagRendererPtr;
-
-    class HeaderRenderer: public TagRenderer {
-		int level;
-	protected:
-		const char *tag_name();
-		var_id_t class_parameter(HtmlGenerator *generator);
-		var_id_t style_parameter(HtmlGenerator *generator);
-	public:
-		HeaderRenderer(int level) :
-				TagRenderer() {
-			this->level = level;
-		}
-
+	/**
+	 * How the lines within a block are rendered.
+	 */
+	enum LineModes {
+		LINE_TEXT,
+		LINE_PREFORMATED,
+		LINE_LIST_ITEM,
+		LINE_IMAGE,
+		LINE_NONE
 	};
 
-	class ImageRenderer: public TagRenderer {
-	protected:
-		const char *tag_name() {
-			return "img";
-		}
-
-		var_id_t class_parameter(HtmlGenerator *generator) {
-			return generator->html_img_class;
-		}
-
-		var_id_t style_parameter(HtmlGenerator *generator) {
-			return generator->html_img_style;
-		}
-
-	public:
-		void line(HtmlGenerator *generator);
-		void close(HtmlGenerator *generator);
-	};
-	class ParagraphRenderer: public TagRenderer {
-	protected:
-		const char *tag_name() {
-			return "p";
-		}
-
-		var_id_t class_parameter(HtmlGenerator *generator) {
-			return generator->html_p_class;
-		}
-
-		var_id_t style_parameter(HtmlGenerator *generator) {
-			return generator->html_p_style;
-		}
-
-	};
-	class CiteParagraphRenderer: public TagRenderer {
-	protected:
-		const char *tag_name() {
-			return "p";
-		}
-
-		var_id_t class_parameter(HtmlGenerator *generator) {
-			return generator->html_cite_p_class;
-		}
-
-		var_id_t style_parameter(HtmlGenerator *generator) {
-			return generator->html_cite_p_style;
-		}
-
-	};
-
-	class CiteRenderer: public TagRenderer {
-	protected:
-		const char *tag_name() {
-			return "cite";
-		}
-
-		var_id_t class_parameter(HtmlGenerator *generator) {
-			return generator->html_cite_class;
-		}
-
-		var_id_t style_parameter(HtmlGenerator *generator) {
-			return generator->html_cite_style;
-		}
-
-		void line(HtmlGenerator *generator);
-	};
-
-	class VerseRenderer: public TagRenderer {
-	protected:
-		const char *tag_name() {
-			return "p";
-		}
-
-		var_id_t class_parameter(HtmlGenerator *generator) {
-			return generator->html_verse_class;
-		}
-
-		var_id_t style_parameter(HtmlGenerator *generator) {
-			return generator->html_verse_style;
-		}
-
-	};
-
-	class PreformatedRenderer: public TagRenderer {
-	protected:
-		const char *tag_name() {
-			return "pre";
-		}
-
-		var_id_t class_parameter(HtmlGenerator *generator) {
-			return generator->html_pre_class;
-		}
-
-		var_id_t style_parameter(HtmlGenerator *generator) {
-			return generator->html_pre_style;
-		}
-
-		void line(HtmlGenerator *generator);
-	};
-
-	class LineBreakRenderer: public TagRenderer {
-	protected:
-		const char *tag_name() {
-			return "br";
-		}
-
-		var_id_t class_parameter(HtmlGenerator *generator) {
-			return UNKNOWN_VAR;
-		}
-
-		var_id_t style_parameter(HtmlGenerator *generator) {
-			return UNKNOWN_VAR;
-		}
-
-	};
-
-	class OrderedListRenderer: public TagRenderer {
-	protected:
-		const char *tag_name() {
-			return "ol";
-		}
-
-		var_id_t class_parameter(HtmlGenerator *generator) {
-			return generator->html_ol_class;
-		}
-
-		var_id_t style_parameter(HtmlGenerator *generator) {
-			return generator->html_ol_style;
-		}
-
-		void line(HtmlGenerator *generator);
-	};
-
-	class UnorderedListRenderer: public TagRenderer {
-	protected:
-		const char *tag_name() {
-			return "ul";
-		}
-
-		var_id_t class_parameter(HtmlGenerator *generator) {
-			return generator->html_ul_class;
-		}
-
-		var_id_t style_parameter(HtmlGenerator *generator) {
-			return generator->html_ul_style;
-		}
-
-		void line(HtmlGenerator *generator);
-	};
-
-	class HorizontalLineRenderer: public TagRenderer {
-	protected:
-		const char *tag_name() {
-			return "hr";
-		}
-
-		var_id_t class_parameter(HtmlGenerator *generator) {
-			return generator->html_hr_class;
-		}
-
-		var_id_t style_parameter(HtmlGenerator *generator) {
-			return generator->html_hr_style;
-		}
-
-	};
-
-	class SectionRenderer: public TagRenderer {
-	protected:
-		const char *tag_name() {
-			return "div";
-		}
-
-		var_id_t class_parameter(HtmlGenerator *generator) {
-			return generator->html_section_class;
-		}
-
-		var_id_t style_parameter(HtmlGenerator *generator) {
-			return generator->html_section_style;
-		}
-
-		void line(HtmlGenerator *generator);
-	};
-
-	class OrderedMultilevelListRenderer: public TagRenderer {
-		const char *tag_name() {
-			return "ul";
-		}
-
-		var_id_t class_parameter(HtmlGenerator *generator) {
-			return generator->html_ol_ml_class;
-		}
-
-		var_id_t style_parameter(HtmlGenerator *generator) {
-			return generator->html_ol_ml_style;
-		}
-
-		void line(HtmlGenerator *generator);
-	};
-
-	class UnorderedMultilevelListRenderer: public TagRenderer {
-		int level;
-	protected:
-		const char *tag_name() {
-			return "ul";
-		}
-
-		var_id_t class_parameter(HtmlGenerator *generator);
-		var_id_t style_parameter(HtmlGenerator *generator);
-		void line(HtmlGenerator *generator);
-	public:
-		UnorderedMultilevelListRenderer(int level) :
-				TagRenderer() {
-			this->level = level;
-		}
-
-	};
-
-	class OrderedListItemRenderer: public TagRenderer {
-		int level;
-	protected:
-		const char *tag_name() {
-			return "li";
-		}
-
-		var_id_t class_parameter(HtmlGenerator *generator);
-		var_id_t style_parameter(HtmlGenerator *generator);
-		const char *static_style() const;
-	public:
-		OrderedListItemRenderer(int level) :
-				TagRenderer() {
-			this->level = level;
-		}
-
-	};
-
-	class UnorderedListItemRenderer: public TagRenderer {
-		int level;
-	protected:
-		const char *tag_name() {
-			return "li";
-		}
-
-		var_id_t class_parameter(HtmlGenerator *generator);
-		var_id_t style_parameter(HtmlGenerator *generator);
-	public:
-		UnorderedListItemRenderer(int level) :
-				TagRenderer() {
-			this->level = level;
-		}
-
+	/**
+	 * Description of the HTML tag a block is rendered to. The renderer
+	 * without tag_name renders nothing (e.g. a comment).
+	 */
+	struct TagRenderer {
+		const char* tag_name;
+		var_id_t class_var;
+		var_id_t style_var;
+		const char* static_style;
+		LineModes line_mode;
 	};
 
 	class AbstractInlineTag {
@@ -374,20 +109,33 @@ class HtmlGenerator: public AbstractGenerator {
 		}
 
 	public:
-		~AbstractInlineTag() {
+		virtual ~AbstractInlineTag() {
 		}
 
-		void append_markup_to_value(const MarkupBuilder & markup);
+		virtual void append_markup_to_value(const MarkupBuilder & markup);
+
+		/**
+		 * Called when the block defining the tag is closed.
+		 */
+		virtual void complete(HtmlGenerator *generator) =0;
 		virtual void open(HtmlGenerator *generator) =0;
 		virtual void close(HtmlGenerator *generator) =0;
 	};
 	class LinkInlineTag: public AbstractInlineTag {
-		std::string buffer;
+		//Opening anchor and the version of the link attributes it has
+		//been rendered with; 0 if it has to be rendered. The anchor is
+		//a decoration of the document, so it is kept out of the DecorationTable.
+		std::string anchor;
+		unsigned int anchor_version;
+
+		void render_anchor(HtmlGenerator *generator);
 	public:
 		LinkInlineTag(const std::wstring & name) :
-				AbstractInlineTag(name) {
+				AbstractInlineTag(name), anchor_version(0) {
 		}
 
+		void append_markup_to_value(const MarkupBuilder & markup);
+		void complete(HtmlGenerator *generator);
 		void open(HtmlGenerator *generator);
 		void close(HtmlGenerator *generator);
 	};
@@ -395,89 +143,176 @@ class HtmlGenerator: public AbstractGenerator {
     static const int MAX_ML_LIST_DEPTH = 6;
     static const int MAX_HEADER_DEPTH = 6;
 
-    var_id_t html_no_line_breaks;
-    var_id_t html_no_default_paragraphs;
-    var_id_t html_no_shys;
-    var_id_t html_default_p_alignment;
-    var_id_t html_embedded_css;
-    var_id_t html_doc_title;
-    var_id_t html_body_class;
-    var_id_t html_body_style;
-    var_id_t html_h1_class;
-    var_id_t html_h1_style;
-    var_id_t html_h2_class;
-    var_id_t html_h2_style;
-    var_id_t html_h3_class;
-    var_id_t html_h3_style;
-    var_id_t html_h4_class;
-    var_id_t html_h4_style;
-    var_id_t html_h5_class;
-    var_id_t html_h5_style;
-    var_id_t html_h6_class;
-    var_id_t html_h6_style;
-    var_id_t html_p_class;
-    var_id_t html_p_style;
-    var_id_t html_cite_p_class;
-    var_id_t html_cite_p_style;
-    var_id_t html_cite_class;
-    var_id_t html_cite_style;
-    var_id_t html_verse_class;
-    var_id_t html_verse_style;
-    var_id_t html_pre_class;
-    var_id_t html_pre_style;
-    var_id_t html_ol_class;
-    var_id_t html_ol_style;
-    var_id_t html_ul_class;
-    var_id_t html_ul_style;
-    var_id_t html_link_class;
-    var_id_t html_link_style;
-    var_id_t html_section_class;
-    var_id_t html_section_style;
-    var_id_t html_hr_class;
-    var_id_t html_hr_style;
-    var_id_t html_img_class;
-    var_id_t html_img_style;
-    var_id_t html_ol_ml_class;
-    var_id_t html_ol_ml_style;
-    var_id_t html_ul_ml_l1_class;
-    var_id_t html_ul_ml_l2_class;
-    var_id_t html_ul_ml_l3_class;
-    var_id_t html_ul_ml_l4_class;
-    var_id_t html_ul_ml_l5_class;
-    var_id_t html_ul_ml_l6_class;
-    var_id_t html_ul_ml_l1_style;
-    var_id_t html_ul_ml_l2_style;
-    var_id_t html_ul_ml_l3_style;
-    var_id_t html_ul_ml_l4_style;
-    var_id_t html_ul_ml_l5_style;
-    var_id_t html_ul_ml_l6_style;
-    var_id_t html_ul_li_l1_class, html_ol_li_l1_class;
-    var_id_t html_ul_li_l2_class, html_ol_li_l2_class;
-    var_id_t html_ul_li_l3_class, html_ol_li_l3_class;
-    var_id_t html_ul_li_l4_class, html_ol_li_l4_class;
-    var_id_t html_ul_li_l5_class, html_ol_li_l5_class;
-    var_id_t html_ul_li_l6_class, html_ol_li_l6_class;
-    var_id_t html_ul_li_l1_style, html_ol_li_l1_style;
-    var_id_t html_ul_li_l2_style, html_ol_li_l2_style;
-    var_id_t html_ul_li_l3_style, html_ol_li_l3_style;
-    var_id_t html_ul_li_l4_style, html_ol_li_l4_style;
-    var_id_t html_ul_li_l5_style, html_ol_li_l5_style;
-    var_id_t html_ul_li_l6_style, html_ol_li_l6_style;
-    var_id_t html_li_index_class;
-    var_id_t html_li_index_style;
-    var_id_t list_format;
-
-    TagRendererPtr renderers[TAG_RENDERERS_COUNT];
+	/**
+	 * Built-in variables of the generator. The values are
+	 * the IDs of the variables.
+	 */
+	enum Variables {
+		VAR_HTML_NO_LINE_BREAKS,
+		VAR_HTML_NO_DEFAULT_PARAGRAPHS,
+		VAR_HTML_NO_SHYS,
+		VAR_HTML_DEFAULT_P_ALIGNMENT,
+		VAR_HTML_EMBEDDED_CSS,
+		VAR_HTML_STYLE_CLASSES,
+		VAR_HTML_NO_ENTITIES,
+		VAR_HTML_BROWSER_HYPHENATION,
+		VAR_HTML_MINIFY,
+		VAR_HTML_TOC,
+		VAR_HTML_DOC_TITLE,
+		VAR_HTML_BODY_CLASS,
+		VAR_HTML_BODY_STYLE,
+		VAR_HTML_H1_CLASS,
+		VAR_HTML_H1_STYLE,
+		VAR_HTML_H2_CLASS,
+		VAR_HTML_H2_STYLE,
+		VAR_HTML_H3_CLASS,
+		VAR_HTML_H3_STYLE,
+		VAR_HTML_H4_CLASS,
+		VAR_HTML_H4_STYLE,
+		VAR_HTML_H5_CLASS,
+		VAR_HTML_H5_STYLE,
+		VAR_HTML_H6_CLASS,
+		VAR_HTML_H6_STYLE,
+		VAR_HTML_P_CLASS,
+		VAR_HTML_P_STYLE,
+		VAR_HTML_CITE_P_CLASS,
+		VAR_HTML_CITE_P_STYLE,
+		VAR_HTML_CITE_CLASS,
+		VAR_HTML_CITE_STYLE,
+		VAR_HTML_VERSE_CLASS,
+		VAR_HTML_VERSE_STYLE,
+		VAR_HTML_PRE_CLASS,
+		VAR_HTML_PRE_STYLE,
+		VAR_HTML_OL_CLASS,
+		VAR_HTML_OL_STYLE,
+		VAR_HTML_UL_CLASS,
+		VAR_HTML_UL_STYLE,
+		VAR_HTML_LINK_CLASS,
+		VAR_HTML_LINK_STYLE,
+		VAR_HTML_SECTION_CLASS,
+		VAR_HTML_SECTION_STYLE,
+		VAR_HTML_HR_CLASS,
+		VAR_HTML_HR_STYLE,
+		VAR_HTML_IMG_CLASS,
+		VAR_HTML_IMG_STYLE,
+		VAR_HTML_OL_ML_CLASS,
+		VAR_HTML_OL_ML_STYLE,
+		VAR_HTML_UL_ML_L1_CLASS,
+		VAR_HTML_UL_ML_L2_CLASS,
+		VAR_HTML_UL_ML_L3_CLASS,
+		VAR_HTML_UL_ML_L4_CLASS,
+		VAR_HTML_UL_ML_L5_CLASS,
+		VAR_HTML_UL_ML_L6_CLASS,
+		VAR_HTML_UL_ML_L1_STYLE,
+		VAR_HTML_UL_ML_L2_STYLE,
+		VAR_HTML_UL_ML_L3_STYLE,
+		VAR_HTML_UL_ML_L4_STYLE,
+		VAR_HTML_UL_ML_L5_STYLE,
+		VAR_HTML_UL_ML_L6_STYLE,
+		VAR_HTML_UL_LI_L1_CLASS,
+		VAR_HTML_OL_LI_L1_CLASS,
+		VAR_HTML_UL_LI_L2_CLASS,
+		VAR_HTML_OL_LI_L2_CLASS,
+		VAR_HTML_UL_LI_L3_CLASS,
+		VAR_HTML_OL_LI_L3_CLASS,
+		VAR_HTML_UL_LI_L4_CLASS,
+		VAR_HTML_OL_LI_L4_CLASS,
+		VAR_HTML_UL_LI_L5_CLASS,
+		VAR_HTML_OL_LI_L5_CLASS,
+		VAR_HTML_UL_LI_L6_CLASS,
+		VAR_HTML_OL_LI_L6_CLASS,
+		VAR_HTML_UL_LI_L1_STYLE,
+		VAR_HTML_OL_LI_L1_STYLE,
+		VAR_HTML_UL_LI_L2_STYLE,
+		VAR_HTML_OL_LI_L2_STYLE,
+		VAR_HTML_UL_LI_L3_STYLE,
+		VAR_HTML_OL_LI_L3_STYLE,
+		VAR_HTML_UL_LI_L4_STYLE,
+		VAR_HTML_OL_LI_L4_STYLE,
+		VAR_HTML_UL_LI_L5_STYLE,
+		VAR_HTML_OL_LI_L5_STYLE,
+		VAR_HTML_UL_LI_L6_STYLE,
+		VAR_HTML_OL_LI_L6_STYLE,
+		VAR_HTML_LI_INDEX_CLASS,
+		VAR_HTML_LI_INDEX_STYLE,
+		VAR_LIST_FORMAT,
+		VARIABLES_COUNT
+	};
+
+	static const VariablesManager::Default DEFAULT_VARIABLES[VARIABLES_COUNT];
+
+	//In the order of TagRenderers.
+	static const TagRenderer RENDERERS[TAG_RENDERERS_COUNT];
+
+	/**
+	 * Variables the generators start from; built once on the first use.
+	 */
+	static const VariablesManager& default_variables();
+
+	/**
+	 * Quotes, dash and soft hyphen of the format.
+	 */
+	static const Typography& typography();
+
+	/**
+	 * Typography of the format with the chars written as UTF8
+	 * rather than as entities.
+	 */
+	static const Typography& utf8_typography();
+
+	/**
+	 * Escape sequences of the chars special to HTML.
+	 */
+	static const EscapeTable& escape_table();
+
+    /**
+     * Rendered opening tag; empty if not rendered yet.
+     */
+    struct OpenTag {
+    	std::string bytes;
+    	bool end;
+    	bool close;
+    };
+
+    //Opening tags of the renderers with each alignment; ALIGN_DEFAULT
+    //stands for the tag without attributes.
+    OpenTag open_tags[TAG_RENDERERS_COUNT][ALIGN_DEFAULT + 1];
     VariablesManager var;
     std::stack<TagRenderers,std::vector<TagRenderers> > tag_stack;
-    std::map<std::wstring,AbstractInlineTag*> inline_tags;
-    std::map<int,std::string> quotes;
+
+    //Owns the link tags; a deque keeps their addresses while it grows.
+    std::deque<LinkInlineTag> links;
+    std::unordered_map<std::wstring,AbstractInlineTag*> inline_tags;
+
+    //Changed whenever the class or the style of the links may change.
+    unsigned int link_attributes_version;
     MarkupBuilder markup;
     std::auto_ptr<Language> language;
-    std::auto_ptr<Tokenizer> tokenizer;
     ListItemsCounter list_items_counter;
-    ListFormat current_list_format;
-    bool list_format_changed;
+    std::shared_ptr<const ListFormat> current_list_format;
+
+    //Classes the document header has declared for the styles, by the style
+    //text; empty unless the styles are replaced by classes.
+    std::unordered_map<std::string,std::string> style_classes;
+
+    //Indexes of the current items of each level rendered with the current list format.
+    std::vector<ListIndex> list_indexes;
+
+    /**
+     * Header collected for the table of contents.
+     */
+    struct TocEntry {
+        int level;
+        std::wstring text;
+    };
+
+    //Whether the table of contents is written; known when the doc header is written.
+    bool toc;
+    std::vector<TocEntry> toc_entries;
+
+    //Opening tag of the list item indexes; empty if not rendered yet.
+    //It depends on the variables of the document, so it is kept out of the DecorationTable.
+    std::string list_index_open;
     AbstractInlineTag *current_inline_tag;
     var_id_t current_var;
     AbstractInlineTag *inline_tag_being_rednered;
@@ -489,12 +324,116 @@ class HtmlGenerator: public AbstractGenerator {
 
 	static const char* alignment_css(stml::Alignments alignment);
 
+	/**
+	 * Rewrites a tag rendered by the generator in the shortest form: without
+	 * the extra spaces, the quotes which are not needed and the slash of
+	 * the empty elements. The tag may be left without its '>'.
+	 */
+	static std::string minify_tag(const std::string& tag);
+
+	/**
+	 * Indicates whether the attribute value can be written without quotes.
+	 */
+	static bool is_unquoted_value(const std::string& value);
+
+	inline bool minify() const {
+		return var.get(VAR_HTML_MINIFY).as_boolean();
+	}
+
+	static void write_attributes(
+		std::ostream& out,
+		const char* attr_names[],
+		const char* attr_values[],
+		size_t attr_count,
+		bool exclude_class,
+		bool exclude_style
+	);
+
+	/**
+	 * Writes the opening tag of the renderer with its class and style
+	 * taken from the variables and merged with the attributes.
+	 */
+	void write_open(
+		std::ostream& out,
+		TagRenderers renderer,
+		const char* attr_names[],
+		const char* attr_values[],
+		size_t attr_count,
+		bool end,
+		bool close
+	);
+
+	/**
+	 * Writes the current line within the block of the renderer.
+	 */
+	void render_line(TagRenderers renderer);
+
+	/**
+	 * Writes the current line as an attribute of the image.
+	 */
+	void write_image_attribute(const char* name);
+
+	/**
+	 * Writes the closing tag of the renderer.
+	 */
+	void render_close(TagRenderers renderer);
+
 	void open_aligned_tag(TagRenderers renderer, Alignments alignment);
+
+	/**
+	 * Writes the opening tag of the renderer, rendering it only if
+	 * it has not been rendered with the current variables yet.
+	 */
+	void open_tag(TagRenderers renderer, Alignments alignment, bool end, bool close);
+
+	/**
+	 * Drops the rendered opening tags which depend on the variable.
+	 */
+	void invalidate_open_tags(var_id_t v);
+
+	/**
+	 * Declares a class for each distinct style the renderers have with
+	 * the current variables and writes the classes as CSS.
+	 */
+	void declare_style_classes(std::ostream& css);
+
+	/**
+	 * Returns the class declared for the style, or NULL if the style
+	 * is to be written inline.
+	 */
+	const std::string* style_class(const std::string& style) const;
+
+	/**
+	 * Appends the class and the style attributes to the buffer, writing
+	 * the class of the style instead of the style if it is declared.
+	 */
+	void append_class_and_style(std::string& buffer, const std::string& class_value, const std::string& style_value) const;
+
 	void generate_doc_header();
 
-	void decorate_text();
+	/**
+	 * Returns how the current line is to be decorated.
+	 */
+	TextDecoration text_decoration() const;
 	void refresh_list_format();
 
+	void render_list_index_open();
+
+	/**
+	 * Writes the table of contents of the headers collected so far.
+	 */
+	void write_toc(std::ostream& toc_out);
+
+	/**
+	 * Starts an entry of the output index for the element being opened
+	 * if it is a top-level one.
+	 */
+	inline void begin_block_entry() {
+		if (tag_stack.empty()) {
+			begin_index_entry(OutputIndex::INDEX_ENTRY_BLOCK, 0, 0);
+		}
+	}
+
 public:
 	HtmlGenerator();
 	virtual ~HtmlGenerator();
@@ -531,6 +470,9 @@ public:
 	void line_end();
 	void stress_mark();
 	void close_document();
+
+	const VariablesManager& variables() const;
+	void set_variables(const VariablesManager& prototype);
 };
 
 }
@@ -7,7 +7,7 @@
 
 #include "../../include/markup_builder.hpp"
 #include "../../include/languages/language.hpp"
-#include "../../include/languages/tokenizer.hpp"
+#include "../../include/decoration_pipeline.hpp"
 #include "../../include/variables_manager.hpp"
 #include "../../include/list_items_counter.hpp"
 
@@ -98,33 +98,68 @@ class TexGenerator : public AbstractGenerator {
     	void line(TexGenerator* generator);
     };
 
-    std::map<int, std::string> quotes;
-
     MarkupBuilder markup;
     std::stack<TexRenderers, std::vector<TexRenderers> > tag_stack;
     std::auto_ptr<Language> language;
-    std::auto_ptr<Tokenizer> tokenizer;
     TexRendererPtr renderers[TEX_RENDERERS_COUNT];
     ListItemsCounter list_items_counter;
 
-    var_id_t tex_chapter_line_skip;
-    var_id_t tex_chapter_subtitle_format;
-    var_id_t tex_chapter_numbers;
-    var_id_t tex_section_numbers;
-    var_id_t tex_subsection_numbers;
-    var_id_t tex_subsubsection_numbers;
-    var_id_t tex_br_size;
-    var_id_t tex_hr_width;
-    var_id_t tex_hr_height;
+    /**
+     * Built-in variables of the generator. The values are
+     * the IDs of the variables.
+     */
+    enum Variables {
+        VAR_TEX_CHAPTER_LINE_SKIP,
+        VAR_TEX_CHAPTER_SUBTITLE_FORMAT,
+        VAR_TEX_CHAPTER_NUMBERS,
+        VAR_TEX_SECTION_NUMBERS,
+        VAR_TEX_SUBSECTION_NUMBERS,
+        VAR_TEX_SUBSUBSECTION_NUMBERS,
+        VAR_TEX_BR_SIZE,
+        VAR_TEX_HR_WIDTH,
+        VAR_TEX_HR_HEIGHT,
+        VAR_TEX_TOC,
+        VARIABLES_COUNT
+    };
+
+    static const VariablesManager::Default DEFAULT_VARIABLES[VARIABLES_COUNT];
+
+    /**
+     * Variables the generators start from; built once on the first use.
+     */
+    static const VariablesManager& default_variables();
+
+    /**
+     * Quotes, dash and soft hyphen of the format.
+     */
+    static const Typography& typography();
+
+    /**
+     * Escape sequences of the chars special to TeX.
+     */
+    static const EscapeTable& escape_table();
 
     VariablesManager var;
     var_id_t current_var;
     bool continue_line;
     bool place_line_break;
 
-    void decorate_text();
+    /**
+     * Returns how the current line is to be decorated.
+     */
+    TextDecoration text_decoration() const;
     void ml_list(TexRenderers renderer, int level);
 
+    /**
+     * Starts an entry of the output index for the element being opened
+     * if it is a top-level one.
+     */
+    inline void begin_block_entry() {
+        if (tag_stack.empty()) {
+            begin_index_entry(OutputIndex::INDEX_ENTRY_BLOCK, 0, 0);
+        }
+    }
+
 public:
     TexGenerator();
     virtual ~TexGenerator();
@@ -161,6 +196,9 @@ public:
     void line_continue();
     void line_end();
     void close_document();
+
+    const VariablesManager& variables() const;
+    void set_variables(const VariablesManager& prototype);
 };
 
 }
@@ -12,15 +12,29 @@ protected:
     virtual QuoteTypes opened_alt_quote() const = 0;
     virtual QuoteTypes closed_alt_quote() const = 0;
 
+private:
+
+    /**
+     * Substitutes the quote or the dash at the position of the text.
+     *
+     * @param   quote_alt   whether the next quote is the alternative one;
+     *                      updated when a quote is substituted.
+     */
+    void substitute_punctuation(
+        MarkupBuilder& builder,
+        size_t i,
+        const Typography& typography,
+        bool& quote_alt) const;
+
 public:
     static inline bool is_latin(wchar_t c) {
         return (c >= L'A' && c <= L'Z') || (c >= L'a' && c <= L'z');
     }
 
-    void process_punctuation(
+    void decorate(
         MarkupBuilder& builder,
-        const char* dash,
-        const std::map<int,std::string>& quotes) const;
+        const Typography& typography,
+        HyphenationModes hyphenation) const;
 };
 
 }
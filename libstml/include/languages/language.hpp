@@ -2,22 +2,50 @@
 #define LANGUAGE_HPP_
 
 #include "../stml.hpp"
-
-#include <map>
+#include "../decoration_table.hpp"
+#include "typography.hpp"
 
 namespace stml {
 
+/**
+ * Words Language::decorate() hyphenates.
+ */
+enum HyphenationModes {
+    HYPHENATE_NONE,
+    HYPHENATE_WORDS,
+    //Only the parts of the compound words, like "кто-нибудь".
+    HYPHENATE_COMPOUND_WORDS
+};
+
 class Language {
 public:
+    /**
+     * Returns the code of the language as in the HTML lang attribute.
+     */
+    virtual const char* code() const = 0;
+
     virtual bool is_word_char(wchar_t c) const = 0;
     virtual wchar_t to_lower(wchar_t c) const = 0;
     virtual wchar_t to_upper(wchar_t c) const = 0;
 
-    virtual void hyphenate(MarkupBuilder& builder, size_t start, size_t length, const char* shy) const = 0;
-    virtual void process_punctuation(
+    virtual void hyphenate(MarkupBuilder& builder, size_t start, size_t length, decoration_id_t shy) const = 0;
+
+    inline void hyphenate(MarkupBuilder& builder, size_t start, size_t length, const char* shy) const {
+        hyphenate(builder, start, length, DecorationTable::intern(shy));
+    }
+
+    /**
+     * Substitutes the quotes and the dashes of the text in the builder
+     * and hyphenates its words in a single pass over the text.
+     *
+     * @param   builder     the text to decorate.
+     * @param   typography  the quotes, the dash and the soft hyphen to use.
+     * @param   hyphenation which words to hyphenate.
+     */
+    virtual void decorate(
         MarkupBuilder& builder,
-        const char* dash,
-        const std::map<int,std::string>& quotes) const = 0;
+        const Typography& typography,
+        HyphenationModes hyphenation) const = 0;
     virtual Tokenizer* create_tokenizer() const = 0;
 };
 
@@ -20,11 +20,13 @@ protected:
     QuoteTypes closed_alt_quote() const { return QUOTE_GERMAN_CLOSED; }
 
 public:
+    const char* code() const { return "ru"; }
     bool is_word_char(wchar_t c) const;
     wchar_t to_lower(wchar_t c) const;
     wchar_t to_upper(wchar_t c) const;
 
-    void hyphenate(MarkupBuilder& builder, size_t start, size_t length, const char* shy) const;
+    using Language::hyphenate;
+    void hyphenate(MarkupBuilder& builder, size_t start, size_t length, decoration_id_t shy) const;
     Tokenizer* create_tokenizer() const;
 
     static inline bool is_cyrillic(wchar_t c) {
@@ -0,0 +1,48 @@
+#ifndef TYPOGRAPHY_HPP_
+#define TYPOGRAPHY_HPP_
+
+#include "../stml.hpp"
+#include "../decoration_table.hpp"
+
+namespace stml {
+
+/**
+ * Typographic chars of an output format: the quotes, the dash and the soft
+ * hyphen the text is decorated with. The strings are interned once, so the
+ * text is decorated by their IDs.
+ */
+class Typography {
+    decoration_id_t quote_ids[QUOTE_TYPES_COUNT];
+    decoration_id_t dash_id;
+    decoration_id_t shy_id;
+
+public:
+
+    /**
+     * @param   quotes  the quotes indexed by QuoteTypes; NULL where the quote
+     *                  char is to be left as is.
+     * @param   dash    what a hyphen followed by a space is substituted with.
+     * @param   shy     the soft hyphen put between the syllables.
+     */
+    Typography(const char* const quotes[QUOTE_TYPES_COUNT], const char* dash, const char* shy);
+
+    /**
+     * Returns the quote of the type, or DecorationTable::NONE
+     * if the quote char is to be left as is.
+     */
+    inline decoration_id_t quote(QuoteTypes type) const {
+        return quote_ids[type];
+    }
+
+    inline decoration_id_t dash() const {
+        return dash_id;
+    }
+
+    inline decoration_id_t shy() const {
+        return shy_id;
+    }
+};
+
+}
+
+#endif /* TYPOGRAPHY_HPP_ */
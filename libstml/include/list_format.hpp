@@ -1,6 +1,9 @@
 #ifndef LIST_FORMAT_HPP_
 #define LIST_FORMAT_HPP_
 
+#include <string>
+#include <memory>
+
 #include "list_index_generators.hpp"
 
 namespace stml {
@@ -29,12 +32,23 @@ public:
 	 */
 	void set(const wchar_t* format);
 
+	/**
+	 * Returns the parsed format from the process-wide cache, parsing it
+	 * on the first request. The formats are never changed once parsed,
+	 * so they are shared by all documents. Safe to be called from several
+	 * threads.
+	 *
+	 * @param format List format string.
+	 * @throws StmlException if the format is not valid.
+	 */
+	static std::shared_ptr<const ListFormat> parse(const std::wstring& format);
+
 	/**
 	 * Returns a list index generator for the specified level.
 	 *
 	 * @param level Level of the item.
 	 */
-	AbstractListIndexGenerator* generator(int level) const;
+	const AbstractListIndexGenerator* generator(int level) const;
 };
 
 }
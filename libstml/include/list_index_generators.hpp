@@ -2,34 +2,72 @@
 #define LIST_INDEX_GENERATORS_HPP_
 
 #include <vector>
-#include <cstring>
+#include <string>
 
 namespace stml {
 
 /**
- * Base class for all list index generators.
+ * Index of the current item of a list as rendered by a generator. The index
+ * is kept between the items, so the generator renders again only the part
+ * of the path which has changed since the previous item. An index must be
+ * updated by the same generator each time.
+ */
+class ListIndex {
+public:
+	std::wstring text;
+
+	//Path the text is rendered for.
+	std::vector<int> path;
+
+	//Length of the text rendered for each level of the path.
+	std::vector<size_t> ends;
+
+	inline void clear() {
+		text.clear();
+		path.clear();
+		ends.clear();
+	}
+};
+
+/**
+ * Base class for all list index generators. The generators don't change
+ * while rendering the indexes, so a generator can be shared by the lists
+ * being rendered on several threads.
  */
 class AbstractListIndexGenerator {
 protected:
-	static const size_t BUFFER_SIZE = 50;
+	static const size_t MAX_INDEX_LENGTH = 49;
 
-	wchar_t buffer[BUFFER_SIZE];
+	/**
+	 * Appends a number to the text in the format of the generator.
+	 *
+	 * @return false if the number can't be written in the format.
+	 */
+	virtual bool append_number(std::wstring& text, int number) const = 0;
 
-	inline void init_buffer() { memset(buffer, 0, BUFFER_SIZE * sizeof(wchar_t)); }
+	/**
+	 * Renders the last number of the path in the brackets,
+	 * unless the index is rendered for the number already.
+	 */
+	void update_last_number(
+		const std::vector<int>& item_path,
+		ListIndex& index,
+		wchar_t left_bracket,
+		wchar_t right_bracket
+	) const;
 
 public:
 
 	virtual ~AbstractListIndexGenerator() { }
 
 	/**
-	 * Generates an index for the item with the specified path.
+	 * Updates the index for the item with the specified path.
 	 *
 	 * @param item_path Path to the item.
-	 * @return Pointer to wchar_t string containing the index.
-	 *         The pointer is valid until the next call to the method.
+	 * @param index The index rendered for the previous item.
 	 * @throws StmlException If the index is too large or too deep.
 	 */
-	virtual const wchar_t* generate_index(const std::vector<int>& item_path) = 0;
+	virtual void update_index(const std::vector<int>& item_path, ListIndex& index) const = 0;
 };
 
 class NumericListIndexGenerator : public AbstractListIndexGenerator {
@@ -38,13 +76,9 @@ protected:
 	virtual ~NumericListIndexGenerator() { }
 
 	/**
-	 * Writes a non-negative integer value to the buffer at the specified position.
-	 *
-	 * @param at     The position.
-	 * @param number The value.
-	 * @return The position right after the written number or -1 if overflow occurred.
+	 * Appends a non-negative integer value to the text.
 	 */
-	int write_to_buffer(int at, int number);
+	bool append_number(std::wstring& text, int number) const;
 };
 
 /**
@@ -57,7 +91,11 @@ public:
 	MultiLevelNumericListIndexGenerator();
 	virtual ~MultiLevelNumericListIndexGenerator() { }
 
-	const wchar_t* generate_index(const std::vector<int>& item_path);
+	/**
+	 * Renders the levels of the path starting from the first one
+	 * which differs from the path of the index.
+	 */
+	void update_index(const std::vector<int>& item_path, ListIndex& index) const;
 };
 
 /**
@@ -71,7 +109,7 @@ public:
 	SingleLevelListIndexGenerator(wchar_t left_bracket, wchar_t right_bracket);
 	virtual ~SingleLevelListIndexGenerator() { }
 
-	const wchar_t* generate_index(const std::vector<int>& item_path);
+	void update_index(const std::vector<int>& item_path, ListIndex& index) const;
 };
 
 class BracketedIndexGenerator : public AbstractListIndexGenerator {
@@ -79,23 +117,12 @@ class BracketedIndexGenerator : public AbstractListIndexGenerator {
 	wchar_t right_bracket;
 
 protected:
-
-	/**
-	 * Writes a positive integer value to the buffer at the specified position
-	 * using the format provided by implementor.
-	 *
-	 * @param at     The position.
-	 * @param number The value.
-	 * @return The position right after the written number or -1 if overflow occurred.
-	 */
-	virtual int write_to_buffer(int at, int number) = 0;
-
 	BracketedIndexGenerator(wchar_t left_bracket, wchar_t right_bracket);
 	virtual ~BracketedIndexGenerator() { }
 
 public:
 
-	const wchar_t* generate_index(const std::vector<int>& item_path);
+	void update_index(const std::vector<int>& item_path, ListIndex& index) const;
 };
 
 /**
@@ -107,7 +134,7 @@ class CharRangeIndexGenerator : public BracketedIndexGenerator {
 	wchar_t range_end;
 
 protected:
-	int write_to_buffer(int at, int number);
+	bool append_number(std::wstring& text, int number) const;
 
 public:
 	CharRangeIndexGenerator(wchar_t left_bracket, wchar_t right_bracket, wchar_t range_start, wchar_t range_end);
@@ -121,7 +148,7 @@ class RomanNumbersIndexGenerator : public BracketedIndexGenerator {
 	bool use_capitals;
 
 protected:
-	int write_to_buffer(int at, int number);
+	bool append_number(std::wstring& text, int number) const;
 
 public:
 	RomanNumbersIndexGenerator(wchar_t left_bracket, wchar_t right_bracket, bool use_capitals);
@@ -0,0 +1,51 @@
+#ifndef LIST_INDEX_TABLES_HPP_
+#define LIST_INDEX_TABLES_HPP_
+
+#include <cstddef>
+
+namespace stml {
+
+/**
+ * List indexes of the common numbers computed at compile time. Each table
+ * is a packed string of the indexes of the numbers from 1 to the count
+ * with the offset of each index in it.
+ */
+class ListIndexTables {
+public:
+
+	/**
+	 * Greatest number the Roman numerals are tabulated for.
+	 */
+	static const int ROMAN_COUNT = 3999;
+
+	/**
+	 * Size of the letter ranges the letter indexes are tabulated for (A-Z).
+	 */
+	static const int LETTERS_RADIX = 26;
+
+	/**
+	 * Greatest number the letter indexes are tabulated for (ZZZ).
+	 */
+	static const int LETTERS_COUNT = LETTERS_RADIX + LETTERS_RADIX * LETTERS_RADIX + LETTERS_RADIX * LETTERS_RADIX * LETTERS_RADIX;
+
+	/**
+	 * Returns the Roman numeral of the number in capitals.
+	 *
+	 * @param number from 1 to ROMAN_COUNT.
+	 * @param length receives the length of the numeral.
+	 */
+	static const char* roman(int number, size_t& length);
+
+	/**
+	 * Returns the letter index of the number as the positions
+	 * of its letters in the range (0 for A, 1 for B etc).
+	 *
+	 * @param number from 1 to LETTERS_COUNT.
+	 * @param length receives the number of the letters.
+	 */
+	static const char* letters(int number, size_t& length);
+};
+
+}
+
+#endif /* LIST_INDEX_TABLES_HPP_ */
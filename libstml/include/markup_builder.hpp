@@ -4,91 +4,225 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <map>
+#include <memory>
+
+#include "decoration_table.hpp"
+#include "escape_table.hpp"
 
 namespace stml {
 
 class MarkupBuilder {
     class Char {
+        //Decorations written after the char are marked with this bit.
+        static const decoration_id_t FOLLOWING = 0x80000000;
+
+        //Decorations kept in the char rather than in the DecorationTable are
+        //marked with this bit; the rest of the bits is the length of the string.
+        //The bytes of the string follow packed by four, and then the mark is
+        //repeated, so that the decorations can be walked in both directions.
+        static const decoration_id_t INLINE = 0x40000000;
+        static const decoration_id_t INLINE_LENGTH = 0x0FFFFFFF;
+
         wchar_t itself;
-        std::vector<char> preceding;
-        std::vector<char> substituting;
-        std::vector<char> following;
+        decoration_id_t substituting;
+
+        //Preceding and following decorations in the order they were added.
+        std::u32string decorations;
 
         static void put_char(wchar_t c, std::ostream& out);
 
-    public:
+        /**
+         * Returns the number of the elements of the decoration
+         * starting or ending with the element.
+         */
+        static inline size_t decoration_size(decoration_id_t d) {
+            return (d & INLINE) ? ((d & INLINE_LENGTH) + 3) / 4 + 2 : 1;
+        }
 
-        inline Char() { }
-        inline Char(const Char& c) { *this = c; }
+        static void write_decoration(std::ostream& out, const std::u32string& decorations, size_t at);
+        static void write_preceding(std::ostream& out, const std::u32string& decorations);
+        static void write_following(std::ostream& out, const std::u32string& decorations);
 
-        inline Char& operator =(const Char& c) {
-            itself = c.itself;
-            preceding = c.preceding;
-            substituting = c.substituting;
-            following = c.following;
-            return *this;
-        }
+        void push_inline(const std::string& str, decoration_id_t following);
+
+        /**
+         * Writes the char with the decorations of 'over' (may be NULL)
+         * applied on top of its own ones.
+         */
+        void write(std::ostream& out, const Char* over, const EscapeTable* escapes) const;
+
+    public:
+
+        inline Char() : itself(L'\0'), substituting(DecorationTable::NONE) { }
 
         inline void clear() {
             itself = L'\0';
-            preceding.clear();
-            substituting.clear();
-            following.clear();
+            substituting = DecorationTable::NONE;
+            decorations.clear();
         }
 
         inline void set(wchar_t c) {
         	itself = c;
         }
 
-        inline void prepend(const char* str) {
-            size_t len = std::char_traits<char>::length(str);
+        inline void swap(Char& c) {
+            std::swap(itself, c.itself);
+            std::swap(substituting, c.substituting);
+            decorations.swap(c.decorations);
+        }
 
-            if (len > 0) {
-                for(size_t i = len; i > 0; --i) {
-                    prepend(str[i - 1]);
-                }
-            }
+        inline bool decorated() const {
+            return substituting != DecorationTable::NONE || !decorations.empty();
+        }
+
+        inline bool substituted() const {
+            return substituting != DecorationTable::NONE;
+        }
+
+        inline void prepend(decoration_id_t id) {
+            decorations.push_back(id);
+        }
+
+        inline void prepend(const char* str) {
+            prepend(DecorationTable::intern(str));
         }
 
         inline void prepend(char c) {
-            preceding.push_back(c);
+            const char str[] = { c, '\0' };
+            prepend(str);
         }
 
-        inline void append(const char* str) {
-            size_t len = std::char_traits<char>::length(str);
+        /**
+         * Adds the decoration kept in the char itself, for the strings which
+         * are not to stay in the DecorationTable (e.g. the ones of a document).
+         */
+        inline void prepend_inline(const std::string& str) {
+            push_inline(str, 0);
+        }
+
+        inline void append(decoration_id_t id) {
+            decorations.push_back(id | FOLLOWING);
+        }
 
-            if (len > 0) {
-                for(size_t i = 0; i < len; ++i) {
-                    append(str[i]);
-                }
-            }
+        inline void append(const char* str) {
+            append(DecorationTable::intern(str));
         }
 
         inline void append(char c) {
-            following.push_back(c);
+            const char str[] = { c, '\0' };
+            append(str);
+        }
+
+        /**
+         * Adds the decoration kept in the char itself; see prepend_inline().
+         */
+        inline void append_inline(const std::string& str) {
+            push_inline(str, FOLLOWING);
+        }
+
+        inline void substitute(decoration_id_t id) {
+            substituting = id;
+        }
+
+        inline void substitute(const char* str) {
+            substitute(DecorationTable::intern(str));
         }
 
         inline void substitute(char c) {
-            substituting.push_back(c);
+            const char str[] = { c, '\0' };
+            substitute(str);
         }
 
+        /**
+         * Adds the decorations of 'c' on top of the decorations of this char
+         * as if they had been applied to this char after its own ones.
+         */
+        void merge(const Char& c);
+
+        /**
+         * Writes the char escaped with the table unless it is substituted.
+         */
+        void write(std::ostream& out, const EscapeTable* escapes = NULL) const;
+
+        /**
+         * Writes the char with the additional decorations 'over'
+         * applied on top of its own ones.
+         */
+        void write(std::ostream& out, const Char& over) const;
+    };
+
+public:
+
+    /**
+     * Immutable piece of markup. Segments are shared by reference
+     * between builders and never change once built.
+     */
+    class Segment {
+        friend class MarkupBuilder;
+
+        std::wstring text;
+        std::vector<Char> chars;
+
+        void write(std::ostream& out, size_t from, size_t length) const;
+
+    public:
+        inline const std::wstring& get_text() const { return text; }
+
         void write(std::ostream& out) const;
     };
 
+    typedef std::shared_ptr<const Segment> SegmentPtr;
+
 private:
 
-    static const int DEFAULT_BUFFER_SIZE = 1024;
+    /**
+     * Continuous range of the text which chars are either owned
+     * by the builder (segment is NULL) or spliced from a segment.
+     * The owned chars are escaped with the table of the run.
+     */
+    struct Run {
+        size_t start;
+        size_t length;
+        size_t offset;
+        SegmentPtr segment;
+        const EscapeTable* escapes;
+    };
+
+    //Number of chars the builder holds without allocating memory.
+    static const size_t INLINE_BUFFER_SIZE = 8;
 
     std::wstring text;
-    std::vector<Char> buffer;
+    Char inline_buffer[INLINE_BUFFER_SIZE];
+    Char* buffer;
+    size_t buffer_size;
     size_t chars_in_buffer;
+    std::vector<Run> runs;
+
+    //Table the chars being added are escaped with; NULL if they are written as is.
+    const EscapeTable* escapes;
+
+    //Decorations added to the spliced chars, by position in the text.
+    std::map<size_t, Char> overlay;
+
+    //Content of the builder as a segment; built on demand.
+    mutable SegmentPtr frozen;
 
     void ensure_storage_for_next_char();
+    void grow_buffer(size_t size);
+    void release_buffer();
+    Char& char_at(size_t index);
+
+    /**
+     * Writes the undecorated chars converting them to UTF8 in bulk.
+     */
+    static void write_text(std::ostream& out, const wchar_t* text, size_t length, const EscapeTable* escapes);
 
 public:
 
     MarkupBuilder();
     MarkupBuilder(const MarkupBuilder& builder);
+    ~MarkupBuilder();
 
     MarkupBuilder& operator =(const MarkupBuilder& builder);
     Char& operator [](size_t index);
@@ -96,8 +230,24 @@ public:
     MarkupBuilder& operator <<(wchar_t c);
     MarkupBuilder& operator <<(const MarkupBuilder& markup);
 
+    /**
+     * Splices the segment into the end of the builder. The chars of
+     * the segment are not copied; they are written out of the segment
+     * along with the decorations added to them by this builder.
+     */
+    MarkupBuilder& operator <<(const SegmentPtr& segment);
+
     void substitute(size_t index, size_t length, const char* str);
 
+    /**
+     * Makes the chars added after the call be escaped with the table when
+     * written; NULL to write them as is. The chars added before are not
+     * affected. Substituted chars are never escaped.
+     */
+    inline void set_escapes(const EscapeTable* table) {
+        escapes = table;
+    }
+
     void clear();
     bool empty() const;
     Char& first_char();
@@ -107,6 +257,12 @@ public:
 
     const std::wstring& get_text() const;
 
+    /**
+     * Returns the content of the builder as an immutable segment.
+     * The segment is built once and then shared until the builder changes.
+     */
+    SegmentPtr segment() const;
+
     void write(std::ostream& out) const;
     void append(std::string& str) const;
 };
@@ -0,0 +1,101 @@
+#ifndef OUTPUT_INDEX_HPP_
+#define OUTPUT_INDEX_HPP_
+
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace stml {
+
+/**
+ * Positions of the headers, sections and top-level blocks of a document
+ * in the generated output, collected while the output is written. Having
+ * the index, a part of the output can be read without parsing it.
+ */
+class OutputIndex {
+public:
+
+	/**
+	 * Kinds of the indexed elements.
+	 */
+	enum EntryKinds {
+		INDEX_ENTRY_HEADER, INDEX_ENTRY_SECTION, INDEX_ENTRY_BLOCK
+	};
+
+	struct Entry {
+		EntryKinds kind;
+
+		//Level of the header; 0 for the other elements.
+		int level;
+
+		//Line of the STML where the element starts.
+		unsigned int source_line;
+
+		//Position of the element in the output, in bytes.
+		size_t offset;
+		size_t length;
+
+		//Text of the header; empty for the other elements.
+		std::wstring text;
+	};
+
+private:
+	std::vector<Entry> entries;
+
+public:
+
+	/**
+	 * Adds the entry with the position not known yet.
+	 *
+	 * @return	number of the entry.
+	 */
+	size_t add(EntryKinds kind, int level, unsigned int source_line);
+
+	inline Entry& operator [](size_t n) {
+		return entries[n];
+	}
+
+	inline const Entry& operator [](size_t n) const {
+		return entries[n];
+	}
+
+	inline size_t size() const {
+		return entries.size();
+	}
+
+	void clear();
+
+	/**
+	 * Writes the index as lines of tab separated fields:
+	 * kind (h, s or b), level, source line, offset, length and text in UTF8.
+	 */
+	void write(std::ostream& out) const;
+};
+
+/**
+ * Passes the output to another stream buffer counting the bytes written.
+ */
+class CountingBuffer : public std::streambuf {
+	std::streambuf* target;
+	size_t count;
+
+protected:
+	virtual int_type overflow(int_type c);
+	virtual std::streamsize xsputn(const char* s, std::streamsize n);
+	virtual int sync();
+
+public:
+	CountingBuffer(std::streambuf* target);
+
+	/**
+	 * Returns the number of bytes written so far.
+	 */
+	inline size_t written() const {
+		return count;
+	}
+};
+
+}
+
+#endif /* OUTPUT_INDEX_HPP_ */
@@ -11,10 +11,34 @@ class Parser {
     AbstractParserStatePtr states[PARSER_STATES_COUNT];
     ParserStates current_state;
 
+    void create_states();
+
 public:
     Parser(GeneratorTypes generator_type);
 
+    /**
+     * Creates the parser which generator starts with the variables
+     * of the prototype.
+     */
+    Parser(GeneratorTypes generator_type, const VariablesManager& prototype);
+
+    /**
+     * Makes the generator decorate the lines with the specified number
+     * of threads; see AbstractGenerator::set_decoration_threads().
+     */
+    void set_decoration_threads(unsigned int threads);
+
+    /**
+     * Makes the generator index its output; see AbstractGenerator::set_output_index().
+     */
+    void set_output_index(OutputIndex* index);
+
     void parse(std::istream& in, std::ostream& out);
+
+    /**
+     * Returns the variables of the generator.
+     */
+    const VariablesManager& variables() const;
 };
 
 }
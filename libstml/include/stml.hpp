@@ -18,6 +18,7 @@ class InlineTagParserState;
 class TextParserState;
 class Tokenizer;
 class Language;
+class Typography;
 class MarkupBuilder;
 class AbstractListIndexGenerator;
 class NumericListIndexGenerator;
@@ -27,6 +28,10 @@ class CharRangeIndexGenerator;
 class RomanNumbersIndexGenerator;
 class ListItemsCounter;
 class ListFormat;
+class VariablesManager;
+class DecorationPipeline;
+class OutputIndex;
+struct TextDecoration;
 struct ImageSize;
 
 typedef std::auto_ptr<AbstractGenerator> AbstractGeneratorPtr;
@@ -63,6 +68,14 @@ enum Units {
 	SIZE_EX
 };
 
+/**
+ * Size with its unit.
+ */
+struct UnitSize {
+	int value;
+	Units unit;
+};
+
 /**
  * Types of quotation marks.
  */
@@ -75,7 +88,8 @@ enum QuoteTypes {
 	QUOTE_ENGLISH_OPENED,
 	QUOTE_ENGLISH_CLOSED,
 	QUOTE_ENGLISH_SINGLE_OPENED,
-	QUOTE_ENGLISH_SINGLE_CLOSED
+	QUOTE_ENGLISH_SINGLE_CLOSED,
+	QUOTE_TYPES_COUNT
 };
 
 /**
@@ -150,6 +164,62 @@ const char* unit_str(Units u);
  */
 void parse(std::istream& in, std::ostream& out, GeneratorTypes generator_type);
 
+/**
+ * Parses STML from the in stream and generates output to the out stream
+ * using specified generator, which starts with the variables of the prototype
+ * instead of the default ones.
+ *
+ * @param	prototype	variables returned by make_prototype() for the same
+ * 						generator type.
+ */
+void parse(
+	std::istream& in,
+	std::ostream& out,
+	GeneratorTypes generator_type,
+	const VariablesManager& prototype
+);
+
+/**
+ * Parses STML like parse(), but the lines are decorated (punctuation,
+ * hyphenation) by the specified number of threads while the document
+ * is being parsed. The output is the same as the one of parse().
+ *
+ * @param	prototype	variables returned by make_prototype() or NULL
+ * 						to start with the default ones.
+ * @param	threads		number of the decoration threads.
+ */
+void parse(
+	std::istream& in,
+	std::ostream& out,
+	GeneratorTypes generator_type,
+	const VariablesManager* prototype,
+	unsigned int threads
+);
+
+/**
+ * Parses STML like parse() with the threads, and fills the index with
+ * the positions of the headers, sections and top-level blocks of the document
+ * in the output.
+ *
+ * @param	index	where the entries are added to.
+ */
+void parse(
+	std::istream& in,
+	std::ostream& out,
+	GeneratorTypes generator_type,
+	const VariablesManager* prototype,
+	unsigned int threads,
+	OutputIndex& index
+);
+
+/**
+ * Parses STML which sets variables (e.g. the site-wide CSS classes) and returns
+ * the resulting variables frozen, so that they can be shared by all documents
+ * generated with the same generator type. The output of the STML is discarded.
+ * A document started from the prototype shares the variables it doesn't change.
+ */
+VariablesManager make_prototype(std::istream& in, GeneratorTypes generator_type);
+
 }
 
 #endif /* STML_H_ */
@@ -3,7 +3,10 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include "stml.hpp"
 #include "markup_builder.hpp"
+#include "list_format.hpp"
 #include <stdexcept>
 
 namespace stml {
@@ -20,7 +23,31 @@ typedef size_t var_id_t;
 class VariablesManager {
 public:
 
+	/**
+	 * Name and default value of a built-in variable.
+	 */
+	struct Default {
+		const wchar_t* name;
+		const wchar_t* value;
+	};
+
 	class Variable {
+		//The value the output bytes have been encoded from.
+		mutable stml::MarkupBuilder::SegmentPtr encoded_value;
+		mutable std::string encoded;
+
+		//The value the alignment has been parsed from.
+		mutable stml::MarkupBuilder::SegmentPtr alignment_value;
+		mutable Alignments alignment;
+
+		//The value the size has been parsed from.
+		mutable stml::MarkupBuilder::SegmentPtr size_value;
+		mutable UnitSize size;
+
+		//The value the list format has been parsed from.
+		mutable stml::MarkupBuilder::SegmentPtr list_format_value;
+		mutable std::shared_ptr<const ListFormat> list_format;
+
 	public:
 		std::wstring name;
 		stml::MarkupBuilder markup;
@@ -28,7 +55,10 @@ public:
 		/**
 		 * Default constructor.
 		 */
-		inline Variable() { }
+		inline Variable() : alignment(ALIGN_DEFAULT) {
+			size.value = 0;
+			size.unit = SIZE_PX;
+		}
 
 		/**
 		 * Copy constructor.
@@ -38,6 +68,14 @@ public:
 		inline Variable& operator=(const Variable& var) {
 			name = var.name;
 			markup = var.markup;
+			encoded_value = var.encoded_value;
+			encoded = var.encoded;
+			alignment_value = var.alignment_value;
+			alignment = var.alignment;
+			size_value = var.size_value;
+			size = var.size;
+			list_format_value = var.list_format_value;
+			list_format = var.list_format;
 			return *this;
 		}
 
@@ -56,6 +94,56 @@ public:
 			return markup.get_text();
 		}
 
+		/**
+		 * Returns the variable as it is written to the output (UTF8).
+		 * The bytes are encoded on the first call and then reused
+		 * until the markup of the variable is changed.
+		 */
+		inline const std::string& as_utf8() const {
+			MarkupBuilder::SegmentPtr value = markup.segment();
+
+			if (value != encoded_value) {
+				encoded.clear();
+				markup.append(encoded);
+				encoded_value = value;
+			}
+
+			return encoded;
+		}
+
+		/**
+		 * Returns the alignment the variable specifies (ALIGN_DEFAULT if
+		 * it is not an alignment). The value is parsed on the first call
+		 * and then reused until the markup of the variable is changed.
+		 */
+		inline Alignments as_alignment() const {
+			MarkupBuilder::SegmentPtr value = markup.segment();
+
+			if (value != alignment_value) {
+				alignment = parse_alignment(markup.get_text());
+				alignment_value = value;
+			}
+
+			return alignment;
+		}
+
+		/**
+		 * Returns the size with the unit the variable specifies, like "10pt".
+		 * The unit is SIZE_PX if omitted; the size is zero if the variable
+		 * doesn't start with a number. Parsed on the first call, not when
+		 * the manager is frozen. Safe to be called from several threads.
+		 */
+		UnitSize as_size() const;
+
+		/**
+		 * Returns the list format the variable specifies. The format is parsed
+		 * on the first call and then shared until the markup of the variable
+		 * is changed. Safe to be called from several threads.
+		 *
+		 * @throws StmlException if the variable is not a valid list format.
+		 */
+		std::shared_ptr<const ListFormat> as_list_format() const;
+
 		/**
 		 * Indicates whether the variable contains empty string.
 		 */
@@ -65,16 +153,52 @@ public:
 	};
 
 private:
-	static const size_t DEFAULT_BUFFER_SIZE = 20;
+	static const size_t DEFAULT_INDEX_SIZE = 64;
+
+	typedef std::shared_ptr<Variable> VariablePtr;
+
+	/**
+	 * Variables and their index. Copies of a manager share the storage
+	 * and the variables in it until they change them (copy-on-write).
+	 */
+	struct Storage {
+		std::vector<VariablePtr> vars;
+
+		//Open addressing hash table of the variable IDs by name.
+		//Free slots contain UNKNOWN_VAR. Kept at most half full.
+		std::vector<var_id_t> index;
+	};
+
+	std::shared_ptr<Storage> storage;
+
+	static size_t hash(const wchar_t* name, size_t length);
+
+	/**
+	 * Returns the slot of the index where the variable with the specified
+	 * name is, or the free slot where it is to be put.
+	 */
+	size_t find_slot(const wchar_t* name, size_t length) const;
+
+	/**
+	 * Returns id of the variable with the specified name
+	 * or UNKNOWN_VAR if there is no such variable.
+	 */
+	var_id_t find(const wchar_t* name, size_t length) const;
+
+	/**
+	 * Puts the last created variable into the index, growing it if needed.
+	 */
+	void index_last_var();
 
-	std::vector<Variable> vars;
-	size_t vars_count;
+	/**
+	 * Returns the storage which is not shared with other managers.
+	 */
+	Storage& own_storage();
 
 	/**
-	 * Ensures that the variables buffer (vars) has free
-	 * place for at least one variable.
+	 * Returns the variable which is not shared with other managers.
 	 */
-	void ensure_buffer_size_for_new_var();
+	Variable& own_var(var_id_t id);
 
 public:
 
@@ -83,19 +207,55 @@ public:
 	 */
 	VariablesManager();
 
+	/**
+	 * Creates the variables from the table of built-in variables. The ID
+	 * of each variable is its position in the table. The manager is
+	 * frozen, so it can serve as a prototype right away.
+	 *
+	 * @param	defaults	the table of the variables.
+	 * @param	count		number of the variables in the table.
+	 */
+	VariablesManager(const Default* defaults, size_t count);
+
 	/**
 	 * Returns a writable reference to the variable with the
-	 * specified id.
+	 * specified id. If the variable is shared with other managers,
+	 * it is copied first.
 	 *
 	 * @param	index	ID of the variable.
 	 * @return	Writable reference to the variable identified by 'id'.
-	 * @throws	out_of_range if the variable with the specified ID
-	 *          does not exist.
 	 */
 	inline Variable& operator[](var_id_t id) {
-		return vars[id];
+		return own_var(id);
+	}
+
+	/**
+	 * Returns the variable with the specified id for reading.
+	 * Never copies the variable.
+	 *
+	 * @param	index	ID of the variable.
+	 * @return	Reference to the variable identified by 'id'.
+	 */
+	inline const Variable& get(var_id_t id) const {
+		return *storage->vars[id];
 	}
 
+	/**
+	 * Returns the variable with the specified name for reading.
+	 *
+	 * @param	name	Name of the variable.
+	 * @return	Reference to the variable.
+	 * @throws	out_of_range if the variable with the specified name
+	 *          does not exist.
+	 */
+	const Variable& get(const std::wstring& name) const;
+
+	/**
+	 * Returns the variable with the specified name for reading
+	 * without copying the name.
+	 */
+	const Variable& get(const wchar_t* name) const;
+
 	/**
 	 * Returns writable reference to the variable with the
 	 * specified name.
@@ -105,7 +265,13 @@ public:
 	 * @throws	out_of_range if the variable with the specified ID
 	 *          does not exist.
 	 */
-	Variable& operator[](const std::wstring name);
+	Variable& operator[](const std::wstring& name);
+
+	/**
+	 * Returns writable reference to the variable with the
+	 * specified name without copying the name.
+	 */
+	Variable& operator[](const wchar_t* name);
 
 	/**
 	 * Creates or resets a variable. If the variable with the specified
@@ -125,7 +291,22 @@ public:
 	 * @param name name of a varable.
 	 * @return id of the variable or UNKNOWN_VAR if such variable doesn't exist.
 	 */
-	var_id_t get_by_name(const wchar_t* name);
+	var_id_t get_by_name(const wchar_t* name) const;
+
+	/**
+	 * Prepares the manager to be used as a prototype: encodes and parses
+	 * the values of the variables, so the copies of the manager can read
+	 * the shared variables from several threads without changing them.
+	 */
+	void freeze() const;
+
+	/**
+	 * Indicates whether the manager still shares all its variables
+	 * with the specified one.
+	 */
+	inline bool shares_storage_with(const VariablesManager& manager) const {
+		return storage == manager.storage;
+	}
 };
 
 }
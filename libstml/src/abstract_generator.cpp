@@ -1,6 +1,7 @@
 #include "../include/stml.hpp"
 #include "../include/stml_exception.hpp"
 #include "../include/abstract_generator.hpp"
+#include "../include/decoration_pipeline.hpp"
 
 #include "../include/generators/html_generator.hpp"
 #include "../include/generators/tex_generator.hpp"
@@ -21,11 +22,217 @@ AbstractGenerator* stml::create_generator(GeneratorTypes generator_type) {
 	}
 }
 
+AbstractGenerator::AbstractGenerator() {
+    out = NULL;
+    decoration_threads = 0;
+    output_index = NULL;
+    source_line = 0;
+    indexing = false;
+    destination = NULL;
+    first_held_mark = 0;
+    pipelines_written = 0;
+    first_pipeline_mark = 0;
+}
+
 AbstractGenerator::~AbstractGenerator() {
 }
 
 void AbstractGenerator::set_output(ostream* out) {
-    this->out = out;
+    indexing = (output_index != NULL);
+    mark_offsets.clear();
+    index_marks.clear();
+    open_index_entries.clear();
+    held_marks.clear();
+    held.reset();
+    pipelines_written = 0;
+
+    counting_stream.reset();
+    counting_buffer.reset();
+
+    //The pipeline knows the offsets of the batches it writes.
+    if (indexing && decoration_threads == 0) {
+        counting_buffer.reset(new CountingBuffer(out->rdbuf()));
+        counting_stream.reset(new ostream(counting_buffer.get()));
+        out = counting_stream.get();
+    }
+
+    destination = out;
+
+    if (decoration_threads > 0) {
+        start_pipeline(*out);
+    } else {
+        this->out = out;
+    }
+}
+
+void AbstractGenerator::start_pipeline(ostream& target) {
+    pipeline.reset(new DecorationPipeline(target, decoration_threads));
+    first_pipeline_mark = mark_offsets.size();
+    out = &pipeline->stream();
+}
+
+void AbstractGenerator::finish_pipeline() {
+    pipeline->finish();
+
+    //The offsets in the held output are relative to its start.
+    size_t base = held.get() ? 0 : pipelines_written;
+
+    if (indexing) {
+        const vector<size_t>& marks = pipeline->marks();
+
+        for (size_t i = 0; i < marks.size(); ++i) {
+            mark_offsets.push_back(base + marks[i]);
+        }
+    }
+
+    if (!held.get()) {
+        pipelines_written += pipeline->written();
+    }
+
+    pipeline.reset();
+}
+
+void AbstractGenerator::hold_output() {
+    if (pipeline.get()) {
+        finish_pipeline();
+    }
+
+    held.reset(new ostringstream());
+    first_held_mark = mark_offsets.size();
+
+    if (decoration_threads > 0) {
+        start_pipeline(*held);
+    } else {
+        out = held.get();
+    }
+}
+
+void AbstractGenerator::release_output(const string& preface) {
+    if (pipeline.get()) {
+        finish_pipeline();
+    }
+
+    string held_output = held->str();
+    size_t last_held_mark = mark_offsets.size();
+    held.reset();
+
+    if (decoration_threads > 0) {
+        start_pipeline(*destination);
+    } else {
+        out = destination;
+    }
+
+    out->write(preface.data(), preface.size());
+
+    if (indexing && first_held_mark < last_held_mark) {
+        HeldMarks marks = { first_held_mark, last_held_mark, mark() };
+        held_marks.push_back(marks);
+    }
+
+    out->write(held_output.data(), held_output.size());
+}
+
+void AbstractGenerator::set_decoration_threads(unsigned int threads) {
+    decoration_threads = threads;
+}
+
+void AbstractGenerator::write_decorated(MarkupBuilder& markup, const TextDecoration& decoration) {
+    if (pipeline.get()) {
+        pipeline->submit(markup, decoration);
+    } else {
+        decoration.apply(markup);
+        markup.write(*out);
+    }
+}
+
+void AbstractGenerator::set_output_index(OutputIndex* index) {
+    output_index = index;
+}
+
+size_t AbstractGenerator::mark() {
+    if (pipeline.get()) {
+        return first_pipeline_mark + pipeline->mark();
+    }
+
+    mark_offsets.push_back(held.get() ? (size_t)held->tellp() : counting_buffer->written());
+    return mark_offsets.size() - 1;
+}
+
+void AbstractGenerator::add_index_entry(OutputIndex::EntryKinds kind, int level, size_t depth) {
+    IndexMarks marks;
+    marks.entry = output_index->add(kind, level, source_line);
+    marks.depth = depth;
+    marks.begin = mark();
+    marks.end = marks.begin;
+
+    index_marks.push_back(marks);
+    open_index_entries.push_back(index_marks.size() - 1);
+}
+
+void AbstractGenerator::close_index_entries(size_t depth) {
+    if (index_marks[open_index_entries.back()].depth < depth) {
+        return;
+    }
+
+    size_t end = mark();
+
+    while (!open_index_entries.empty() && index_marks[open_index_entries.back()].depth >= depth) {
+        index_marks[open_index_entries.back()].end = end;
+        open_index_entries.pop_back();
+    }
+}
+
+void AbstractGenerator::add_index_text(const wstring& text) {
+    for (size_t i = open_index_entries.size(); i > 0; --i) {
+        OutputIndex::Entry& entry = (*output_index)[index_marks[open_index_entries[i - 1]].entry];
+
+        if (entry.kind == OutputIndex::INDEX_ENTRY_HEADER) {
+            if (!entry.text.empty() && !text.empty()) {
+                entry.text += L' ';
+            }
+            entry.text += text;
+            return;
+        }
+    }
+}
+
+void AbstractGenerator::resolve_index_entries() {
+    for (vector<HeldMarks>::const_iterator marks = held_marks.begin(); marks != held_marks.end(); ++marks) {
+        if (marks->base < mark_offsets.size()) {
+            for (size_t i = marks->first; i < marks->last; ++i) {
+                mark_offsets[i] += mark_offsets[marks->base];
+            }
+        }
+    }
+
+    for (vector<IndexMarks>::const_iterator marks = index_marks.begin(); marks != index_marks.end(); ++marks) {
+        if (marks->end < mark_offsets.size()) {
+            OutputIndex::Entry& entry = (*output_index)[marks->entry];
+
+            entry.offset = mark_offsets[marks->begin];
+            entry.length = mark_offsets[marks->end] - entry.offset;
+        }
+    }
+
+    index_marks.clear();
+}
+
+void AbstractGenerator::flush() {
+    //The elements left open end with the output.
+    end_index_entries(0);
+
+    //The output held when the document is broken is written as is.
+    if (held.get()) {
+        release_output(string());
+    }
+
+    if (pipeline.get()) {
+        finish_pipeline();
+    }
+
+    if (indexing) {
+        resolve_index_entries();
+    }
 }
 
 ostream* AbstractGenerator::get_output() const {
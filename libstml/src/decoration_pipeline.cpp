@@ -0,0 +1,205 @@
+#include "../include/decoration_pipeline.hpp"
+
+using namespace std;
+using namespace stml;
+
+void TextDecoration::apply(MarkupBuilder& markup) const {
+	language->decorate(markup, *typography, hyphenation);
+}
+
+DecorationPipeline::DecorationPipeline(ostream& out, unsigned int threads) {
+	this->out = &out;
+	max_batches = threads * 2 + 2;
+	stopping = false;
+	marks_count = 0;
+	written_bytes = 0;
+
+	for (unsigned int i = 0; i < threads; ++i) {
+		workers.push_back(thread(&DecorationPipeline::decorate_batches, this));
+	}
+
+	writer = thread(&DecorationPipeline::write_batches, this);
+}
+
+DecorationPipeline::~DecorationPipeline() {
+	stop();
+}
+
+void DecorationPipeline::submit(const MarkupBuilder& markup, const TextDecoration& decoration) {
+	if (!current) {
+		current.reset(new Batch());
+		current->lines.reserve(LINES_PER_BATCH);
+		current->done = false;
+	}
+
+	current->lines.push_back(Line());
+
+	Line& line = current->lines.back();
+	line.prefix = staged.str();
+	line.markup = markup;
+	line.decoration = decoration;
+	line.marks.swap(staged_marks);
+
+	staged.str("");
+
+	if (current->lines.size() == LINES_PER_BATCH) {
+		dispatch();
+	}
+}
+
+size_t DecorationPipeline::mark() {
+	staged_marks.push_back((size_t)staged.tellp());
+	return marks_count++;
+}
+
+void DecorationPipeline::dispatch() {
+	unique_lock<mutex> lock(state_mutex);
+
+	while (unwritten.size() >= max_batches && !error) {
+		batch_written.wait(lock);
+	}
+
+	if (error) {
+		rethrow_exception(error);
+	}
+
+	queued.push_back(current);
+	unwritten.push_back(current);
+	current.reset();
+
+	batch_queued.notify_one();
+}
+
+void DecorationPipeline::finish() {
+	//The output after the last line is written as a line without markup.
+	if (!staged.str().empty() || !staged_marks.empty()) {
+		TextDecoration none = { NULL, NULL, HYPHENATE_NONE };
+		submit(MarkupBuilder(), none);
+	}
+
+	if (current) {
+		dispatch();
+	}
+
+	stop();
+
+	if (error) {
+		rethrow_exception(error);
+	}
+}
+
+void DecorationPipeline::stop() {
+	{
+		lock_guard<mutex> lock(state_mutex);
+		stopping = true;
+	}
+
+	batch_queued.notify_all();
+	batch_done.notify_all();
+
+	for (size_t i = 0; i < workers.size(); ++i) {
+		if (workers[i].joinable()) {
+			workers[i].join();
+		}
+	}
+
+	if (writer.joinable()) {
+		writer.join();
+	}
+}
+
+void DecorationPipeline::decorate_batches() {
+	for (;;) {
+		BatchPtr batch;
+
+		{
+			unique_lock<mutex> lock(state_mutex);
+
+			while (queued.empty() && !stopping) {
+				batch_queued.wait(lock);
+			}
+
+			if (queued.empty()) {
+				return;
+			}
+
+			batch = queued.front();
+			queued.pop_front();
+		}
+
+		try {
+			ostringstream rendered;
+
+			for (vector<Line>::iterator line = batch->lines.begin(); line != batch->lines.end(); ++line) {
+				for (size_t i = 0; i < line->marks.size(); ++i) {
+					batch->marks.push_back((size_t)rendered.tellp() + line->marks[i]);
+				}
+
+				rendered << line->prefix;
+
+				if (line->decoration.language) {
+					line->decoration.apply(line->markup);
+					line->markup.write(rendered);
+				}
+			}
+
+			batch->output = rendered.str();
+		}
+		catch (...) {
+			batch->error = current_exception();
+		}
+
+		//The markup is released by the worker rather than by the writer.
+		batch->lines.clear();
+
+		{
+			lock_guard<mutex> lock(state_mutex);
+			batch->done = true;
+		}
+
+		batch_done.notify_all();
+	}
+}
+
+void DecorationPipeline::write_batches() {
+	for (;;) {
+		BatchPtr batch;
+
+		{
+			unique_lock<mutex> lock(state_mutex);
+
+			while (!(unwritten.empty() ? stopping : unwritten.front()->done)) {
+				batch_done.wait(lock);
+			}
+
+			if (unwritten.empty()) {
+				return;
+			}
+
+			batch = unwritten.front();
+		}
+
+		//Nothing is written after a failed line, like in the generator itself.
+		if (batch->error) {
+			lock_guard<mutex> lock(state_mutex);
+			if (!error) {
+				error = batch->error;
+			}
+		}
+		else if (!error) {
+			for (size_t i = 0; i < batch->marks.size(); ++i) {
+				mark_offsets.push_back(written_bytes + batch->marks[i]);
+			}
+
+			out->write(batch->output.data(), batch->output.size());
+			written_bytes += batch->output.size();
+		}
+
+		{
+			lock_guard<mutex> lock(state_mutex);
+			unwritten.pop_front();
+		}
+
+		batch_written.notify_all();
+	}
+}
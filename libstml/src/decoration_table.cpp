@@ -0,0 +1,57 @@
+#include "../include/decoration_table.hpp"
+
+#include <unordered_map>
+#include <mutex>
+#include <stdexcept>
+
+using namespace std;
+using namespace stml;
+
+string* DecorationTable::chunks[DecorationTable::MAX_CHUNKS];
+
+namespace {
+
+struct Interned {
+	mutex lock;
+	unordered_map<string, decoration_id_t> ids;
+
+	//ID 0 is reserved for NONE.
+	decoration_id_t next_id;
+
+	Interned() : next_id(1) { }
+};
+
+//Constructed on the first use, so the table works during static initialization.
+Interned& interned() {
+	static Interned table;
+	return table;
+}
+
+}
+
+decoration_id_t DecorationTable::intern(const char* str) {
+	Interned& table = interned();
+	lock_guard<mutex> guard(table.lock);
+
+	string key(str);
+	unordered_map<string, decoration_id_t>::const_iterator found = table.ids.find(key);
+	if (found != table.ids.end()) {
+		return found->second;
+	}
+
+	decoration_id_t id = table.next_id;
+	if (id > MAX_ID) {
+		throw overflow_error("decoration table");
+	}
+
+	string*& chunk = chunks[id >> CHUNK_BITS];
+	if (chunk == NULL) {
+		chunk = new string[CHUNK_SIZE];
+	}
+	chunk[id & (CHUNK_SIZE - 1)] = key;
+
+	table.ids[key] = id;
+	++table.next_id;
+
+	return id;
+}
@@ -0,0 +1,71 @@
+#include "../include/escape_table.hpp"
+
+#include <cwchar>
+#include <stdexcept>
+
+#if defined(__SSE2__) && WCHAR_MAX > 0xFFFF
+#include <emmintrin.h>
+#define ESCAPE_TABLE_SSE2
+#endif
+
+using namespace std;
+using namespace stml;
+
+EscapeTable::EscapeTable(const Escape* escapes, size_t count) {
+	if (count > MAX_SPECIALS) {
+		throw logic_error("count");
+	}
+
+	for (size_t c = 0; c < ASCII_SIZE; ++c) {
+		sequences[c] = NULL;
+		ids[c] = DecorationTable::NONE;
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		if ((size_t)escapes[i].c >= ASCII_SIZE) {
+			throw logic_error("escapes");
+		}
+
+		sequences[escapes[i].c] = escapes[i].sequence;
+		ids[escapes[i].c] = DecorationTable::intern(escapes[i].sequence);
+		specials[i] = escapes[i].c;
+	}
+
+	specials_count = count;
+}
+
+size_t EscapeTable::find(const wchar_t* text, size_t from, size_t length) const {
+	size_t i = from;
+
+#ifdef ESCAPE_TABLE_SSE2
+	if (length - i >= 8) {
+		__m128i keys[MAX_SPECIALS];
+		for (size_t k = 0; k < specials_count; ++k) {
+			keys[k] = _mm_set1_epi32(specials[k]);
+		}
+
+		//Four chars at a time; the specials are compared with all of them at once.
+		for (; i + 4 <= length; i += 4) {
+			__m128i chars = _mm_loadu_si128((const __m128i*)(text + i));
+			__m128i found = _mm_setzero_si128();
+
+			for (size_t k = 0; k < specials_count; ++k) {
+				found = _mm_or_si128(found, _mm_cmpeq_epi32(chars, keys[k]));
+			}
+
+			int mask = _mm_movemask_epi8(found);
+			if (mask) {
+				return i + (__builtin_ctz(mask) >> 2);
+			}
+		}
+	}
+#endif
+
+	for (; i < length; ++i) {
+		if (sequence(text[i])) {
+			return i;
+		}
+	}
+
+	return length;
+}
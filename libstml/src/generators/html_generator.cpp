@@ -8,164 +8,268 @@
 
 #include <cstdlib>
 #include <cstdio>
+#include <sstream>
 
 using namespace std;
 using namespace stml;
 
+//In the order of HtmlGenerator::Variables.
+const VariablesManager::Default HtmlGenerator::DEFAULT_VARIABLES[HtmlGenerator::VARIABLES_COUNT] = {
+	{ L"html_no_line_breaks", VAR_FALSE },
+	{ L"html_no_default_paragraphs", VAR_FALSE },
+	{ L"html_no_shys", VAR_FALSE },
+	{ L"html_default_p_alignment", L"aj" },
+	{ L"html_embedded_css", L"" },
+	{ L"html_style_classes", VAR_FALSE },
+	{ L"html_no_entities", VAR_FALSE },
+	{ L"html_browser_hyphenation", VAR_FALSE },
+	{ L"html_minify", VAR_FALSE },
+	{ L"html_toc", VAR_FALSE },
+	{ L"html_doc_title", L"" },
+	{ L"html_body_class", L"" },
+	{ L"html_body_style", L"" },
+	{ L"html_h1_class", L"" },
+	{ L"html_h1_style", L"" },
+	{ L"html_h2_class", L"" },
+	{ L"html_h2_style", L"" },
+	{ L"html_h3_class", L"" },
+	{ L"html_h3_style", L"" },
+	{ L"html_h4_class", L"" },
+	{ L"html_h4_style", L"" },
+	{ L"html_h5_class", L"" },
+	{ L"html_h5_style", L"" },
+	{ L"html_h6_class", L"" },
+	{ L"html_h6_style", L"" },
+	{ L"html_p_class", L"" },
+	{ L"html_p_style", L"" },
+	{ L"html_cite_p_class", L"" },
+	{ L"html_cite_p_style", L"" },
+	{ L"html_cite_class", L"" },
+	{ L"html_cite_style", L"" },
+	{ L"html_verse_class", L"stml_verse" },
+	{ L"html_verse_style", L"" },
+	{ L"html_pre_class", L"" },
+	{ L"html_pre_style", L"" },
+	{ L"html_ol_class", L"" },
+	{ L"html_ol_style", L"" },
+	{ L"html_ul_class", L"" },
+	{ L"html_ul_style", L"" },
+	{ L"html_link_class", L"" },
+	{ L"html_link_style", L"" },
+	{ L"html_section_class", L"" },
+	{ L"html_section_style", L"" },
+	{ L"html_hr_class", L"" },
+	{ L"html_hr_style", L"" },
+	{ L"html_img_class", L"" },
+	{ L"html_img_style", L"" },
+	{ L"html_ol_ml_class", L"" },
+	{ L"html_ol_ml_style", L"" },
+	{ L"html_ul_ml_l1_class", L"" },
+	{ L"html_ul_ml_l2_class", L"" },
+	{ L"html_ul_ml_l3_class", L"" },
+	{ L"html_ul_ml_l4_class", L"" },
+	{ L"html_ul_ml_l5_class", L"" },
+	{ L"html_ul_ml_l6_class", L"" },
+	{ L"html_ul_ml_l1_style", L"" },
+	{ L"html_ul_ml_l2_style", L"" },
+	{ L"html_ul_ml_l3_style", L"" },
+	{ L"html_ul_ml_l4_style", L"" },
+	{ L"html_ul_ml_l5_style", L"" },
+	{ L"html_ul_ml_l6_style", L"" },
+	{ L"html_ul_li_l1_class", L"" },
+	{ L"html_ol_li_l1_class", L"" },
+	{ L"html_ul_li_l2_class", L"" },
+	{ L"html_ol_li_l2_class", L"" },
+	{ L"html_ul_li_l3_class", L"" },
+	{ L"html_ol_li_l3_class", L"" },
+	{ L"html_ul_li_l4_class", L"" },
+	{ L"html_ol_li_l4_class", L"" },
+	{ L"html_ul_li_l5_class", L"" },
+	{ L"html_ol_li_l5_class", L"" },
+	{ L"html_ul_li_l6_class", L"" },
+	{ L"html_ol_li_l6_class", L"" },
+	{ L"html_ul_li_l1_style", L"" },
+	{ L"html_ol_li_l1_style", L"" },
+	{ L"html_ul_li_l2_style", L"" },
+	{ L"html_ol_li_l2_style", L"" },
+	{ L"html_ul_li_l3_style", L"" },
+	{ L"html_ol_li_l3_style", L"" },
+	{ L"html_ul_li_l4_style", L"" },
+	{ L"html_ol_li_l4_style", L"" },
+	{ L"html_ul_li_l5_style", L"" },
+	{ L"html_ol_li_l5_style", L"" },
+	{ L"html_ul_li_l6_style", L"" },
+	{ L"html_ol_li_l6_style", L"" },
+	{ L"html_li_index_class", L"" },
+	{ L"html_li_index_style", L"" },
+	{ L"list_format", DEFAULT_LIST_FORMAT },
+};
+
+//Index numbers are drawn by the generator, so the ordered list items hide the markers.
+#define ORDERED_LIST_ITEM_STYLE ("list-style-type: none;list-style-image: none;")
+
+//In the order of HtmlGenerator::TagRenderers.
+const HtmlGenerator::TagRenderer HtmlGenerator::RENDERERS[HtmlGenerator::TAG_RENDERERS_COUNT] = {
+	{ NULL, UNKNOWN_VAR, UNKNOWN_VAR, "", LINE_NONE },
+	{ "h1", VAR_HTML_H1_CLASS, VAR_HTML_H1_STYLE, "", LINE_TEXT },
+	{ "h2", VAR_HTML_H2_CLASS, VAR_HTML_H2_STYLE, "", LINE_TEXT },
+	{ "h3", VAR_HTML_H3_CLASS, VAR_HTML_H3_STYLE, "", LINE_TEXT },
+	{ "h4", VAR_HTML_H4_CLASS, VAR_HTML_H4_STYLE, "", LINE_TEXT },
+	{ "h5", VAR_HTML_H5_CLASS, VAR_HTML_H5_STYLE, "", LINE_TEXT },
+	{ "h6", VAR_HTML_H6_CLASS, VAR_HTML_H6_STYLE, "", LINE_TEXT },
+	{ "p", VAR_HTML_P_CLASS, VAR_HTML_P_STYLE, "", LINE_TEXT },
+	{ "p", VAR_HTML_CITE_P_CLASS, VAR_HTML_CITE_P_STYLE, "", LINE_TEXT },
+	{ "cite", VAR_HTML_CITE_CLASS, VAR_HTML_CITE_STYLE, "", LINE_NONE },
+	{ "p", VAR_HTML_VERSE_CLASS, VAR_HTML_VERSE_STYLE, "", LINE_TEXT },
+	{ "pre", VAR_HTML_PRE_CLASS, VAR_HTML_PRE_STYLE, "", LINE_PREFORMATED },
+	{ "br", UNKNOWN_VAR, UNKNOWN_VAR, "", LINE_TEXT },
+	{ "ol", VAR_HTML_OL_CLASS, VAR_HTML_OL_STYLE, "", LINE_LIST_ITEM },
+	{ "ul", VAR_HTML_UL_CLASS, VAR_HTML_UL_STYLE, "", LINE_LIST_ITEM },
+	{ NULL, UNKNOWN_VAR, UNKNOWN_VAR, "", LINE_NONE },
+	{ NULL, UNKNOWN_VAR, UNKNOWN_VAR, "", LINE_NONE },
+	{ "div", VAR_HTML_SECTION_CLASS, VAR_HTML_SECTION_STYLE, "", LINE_NONE },
+	{ "hr", VAR_HTML_HR_CLASS, VAR_HTML_HR_STYLE, "", LINE_TEXT },
+	{ NULL, UNKNOWN_VAR, UNKNOWN_VAR, "", LINE_NONE },
+	{ "img", VAR_HTML_IMG_CLASS, VAR_HTML_IMG_STYLE, "", LINE_IMAGE },
+	{ "ul", VAR_HTML_OL_ML_CLASS, VAR_HTML_OL_ML_STYLE, "", LINE_NONE },
+	{ "ul", VAR_HTML_UL_ML_L1_CLASS, VAR_HTML_UL_ML_L1_STYLE, "", LINE_NONE },
+	{ "ul", VAR_HTML_UL_ML_L2_CLASS, VAR_HTML_UL_ML_L2_STYLE, "", LINE_NONE },
+	{ "ul", VAR_HTML_UL_ML_L3_CLASS, VAR_HTML_UL_ML_L3_STYLE, "", LINE_NONE },
+	{ "ul", VAR_HTML_UL_ML_L4_CLASS, VAR_HTML_UL_ML_L4_STYLE, "", LINE_NONE },
+	{ "ul", VAR_HTML_UL_ML_L5_CLASS, VAR_HTML_UL_ML_L5_STYLE, "", LINE_NONE },
+	{ "ul", VAR_HTML_UL_ML_L6_CLASS, VAR_HTML_UL_ML_L6_STYLE, "", LINE_NONE },
+	{ "li", VAR_HTML_OL_LI_L1_CLASS, VAR_HTML_OL_LI_L1_STYLE, ORDERED_LIST_ITEM_STYLE, LINE_TEXT },
+	{ "li", VAR_HTML_OL_LI_L2_CLASS, VAR_HTML_OL_LI_L2_STYLE, ORDERED_LIST_ITEM_STYLE, LINE_TEXT },
+	{ "li", VAR_HTML_OL_LI_L3_CLASS, VAR_HTML_OL_LI_L3_STYLE, ORDERED_LIST_ITEM_STYLE, LINE_TEXT },
+	{ "li", VAR_HTML_OL_LI_L4_CLASS, VAR_HTML_OL_LI_L4_STYLE, ORDERED_LIST_ITEM_STYLE, LINE_TEXT },
+	{ "li", VAR_HTML_OL_LI_L5_CLASS, VAR_HTML_OL_LI_L5_STYLE, ORDERED_LIST_ITEM_STYLE, LINE_TEXT },
+	{ "li", VAR_HTML_OL_LI_L6_CLASS, VAR_HTML_OL_LI_L6_STYLE, ORDERED_LIST_ITEM_STYLE, LINE_TEXT },
+	{ "li", VAR_HTML_UL_LI_L1_CLASS, VAR_HTML_UL_LI_L1_STYLE, "", LINE_TEXT },
+	{ "li", VAR_HTML_UL_LI_L2_CLASS, VAR_HTML_UL_LI_L2_STYLE, "", LINE_TEXT },
+	{ "li", VAR_HTML_UL_LI_L3_CLASS, VAR_HTML_UL_LI_L3_STYLE, "", LINE_TEXT },
+	{ "li", VAR_HTML_UL_LI_L4_CLASS, VAR_HTML_UL_LI_L4_STYLE, "", LINE_TEXT },
+	{ "li", VAR_HTML_UL_LI_L5_CLASS, VAR_HTML_UL_LI_L5_STYLE, "", LINE_TEXT },
+	{ "li", VAR_HTML_UL_LI_L6_CLASS, VAR_HTML_UL_LI_L6_STYLE, "", LINE_TEXT },
+};
+
+const VariablesManager& HtmlGenerator::default_variables() {
+	static const VariablesManager defaults(DEFAULT_VARIABLES, VARIABLES_COUNT);
+	return defaults;
+}
+
+const Typography& HtmlGenerator::typography() {
+	//In the order of QuoteTypes.
+	static const char* const quotes[QUOTE_TYPES_COUNT] = { NULL, "&laquo;", "&raquo;", "&bdquo;", "&ldquo;", "&ldquo;", "&rdquo;", "&lsquo;", "&rsquo;" };
+	static const Typography html_typography(quotes, HTML_DASH, HTML_SHY);
+	return html_typography;
+}
+
+const Typography& HtmlGenerator::utf8_typography() {
+	//The same quotes as in typography(): U+00AB, U+00BB, U+201E, U+201C, U+201C, U+201D, U+2018, U+2019.
+	static const char* const quotes[QUOTE_TYPES_COUNT] = {
+		NULL,
+		"\xC2\xAB", "\xC2\xBB",
+		"\xE2\x80\x9E", "\xE2\x80\x9C",
+		"\xE2\x80\x9C", "\xE2\x80\x9D",
+		"\xE2\x80\x98", "\xE2\x80\x99"
+	};
+	static const Typography html_utf8_typography(quotes, HTML_UTF8_DASH, HTML_UTF8_SHY);
+	return html_utf8_typography;
+}
+
+const EscapeTable& HtmlGenerator::escape_table() {
+	static const EscapeTable::Escape escapes[] = {
+		{ L'&', "&amp;" },
+		{ L'<', "&lt;" },
+		{ L'>', "&gt;" }
+	};
+	static const EscapeTable html_escapes(escapes, sizeof(escapes) / sizeof(escapes[0]));
+	return html_escapes;
+}
+
 HtmlGenerator::HtmlGenerator() :
-	AbstractGenerator() {
+	AbstractGenerator(), var(default_variables()) {
 
 	//TODO: Multiple languages support.
 	language.reset(new RussianLanguage());
-	tokenizer.reset(language->create_tokenizer());
-
-	quotes[QUOTE_FRENCH_OPENED] = "&laquo;";
-	quotes[QUOTE_FRENCH_CLOSED] = "&raquo;";
-	quotes[QUOTE_ENGLISH_OPENED] = "&ldquo;";
-	quotes[QUOTE_ENGLISH_CLOSED] = "&rdquo;";
-	quotes[QUOTE_GERMAN_OPENED] = "&bdquo;";
-	quotes[QUOTE_GERMAN_CLOSED] = "&ldquo;";
-	quotes[QUOTE_ENGLISH_SINGLE_OPENED] = "&lsquo;";
-	quotes[QUOTE_ENGLISH_SINGLE_CLOSED] = "&rsquo;";
-
-	renderers[TAG_RENDERER_HEADER1].reset(new HeaderRenderer(1));
-	renderers[TAG_RENDERER_HEADER2].reset(new HeaderRenderer(2));
-	renderers[TAG_RENDERER_HEADER3].reset(new HeaderRenderer(3));
-	renderers[TAG_RENDERER_HEADER4].reset(new HeaderRenderer(4));
-	renderers[TAG_RENDERER_HEADER5].reset(new HeaderRenderer(5));
-	renderers[TAG_RENDERER_HEADER6].reset(new HeaderRenderer(6));
-	renderers[TAG_RENDERER_PARAGRAPH].reset(new ParagraphRenderer());
-	renderers[TAG_RENDERER_CITE_PARAGRAPH].reset(new CiteParagraphRenderer());
-	renderers[TAG_RENDERER_CITE].reset(new CiteRenderer());
-	renderers[TAG_RENDERER_VERSE].reset(new VerseRenderer());
-	renderers[TAG_RENDERER_PREFORMATED].reset(new PreformatedRenderer());
-	renderers[TAG_RENDERER_LINE_BREAK].reset(new LineBreakRenderer());
-	renderers[TAG_RENDERER_ORDERED_LIST].reset(new OrderedListRenderer());
-	renderers[TAG_RENDERER_UNORDERED_LIST].reset(new UnorderedListRenderer());
-	renderers[TAG_RENDERER_SECTION].reset(new SectionRenderer());
-	renderers[TAG_RENDERER_HORIZONTAL_LINE].reset(new HorizontalLineRenderer());
-	renderers[TAG_RENDERER_IMAGE].reset(new ImageRenderer());
-	renderers[TAG_RENDERER_ORDERED_ML_LIST].reset(new OrderedMultilevelListRenderer());
-	renderers[TAG_RENDERER_UNORDERED_ML_LIST_L1].reset(new UnorderedMultilevelListRenderer(1));
-	renderers[TAG_RENDERER_UNORDERED_ML_LIST_L2].reset(new UnorderedMultilevelListRenderer(2));
-	renderers[TAG_RENDERER_UNORDERED_ML_LIST_L3].reset(new UnorderedMultilevelListRenderer(3));
-	renderers[TAG_RENDERER_UNORDERED_ML_LIST_L4].reset(new UnorderedMultilevelListRenderer(4));
-	renderers[TAG_RENDERER_UNORDERED_ML_LIST_L5].reset(new UnorderedMultilevelListRenderer(5));
-	renderers[TAG_RENDERER_UNORDERED_ML_LIST_L6].reset(new UnorderedMultilevelListRenderer(6));
-	renderers[TAG_RENDERER_ORDERED_LIST_ITEM_L1].reset(new OrderedListItemRenderer(1));
-	renderers[TAG_RENDERER_ORDERED_LIST_ITEM_L2].reset(new OrderedListItemRenderer(2));
-	renderers[TAG_RENDERER_ORDERED_LIST_ITEM_L3].reset(new OrderedListItemRenderer(3));
-	renderers[TAG_RENDERER_ORDERED_LIST_ITEM_L4].reset(new OrderedListItemRenderer(4));
-	renderers[TAG_RENDERER_ORDERED_LIST_ITEM_L5].reset(new OrderedListItemRenderer(5));
-	renderers[TAG_RENDERER_ORDERED_LIST_ITEM_L6].reset(new OrderedListItemRenderer(6));
-	renderers[TAG_RENDERER_UNORDERED_LIST_ITEM_L1].reset(new UnorderedListItemRenderer(1));
-	renderers[TAG_RENDERER_UNORDERED_LIST_ITEM_L2].reset(new UnorderedListItemRenderer(2));
-	renderers[TAG_RENDERER_UNORDERED_LIST_ITEM_L3].reset(new UnorderedListItemRenderer(3));
-	renderers[TAG_RENDERER_UNORDERED_LIST_ITEM_L4].reset(new UnorderedListItemRenderer(4));
-	renderers[TAG_RENDERER_UNORDERED_LIST_ITEM_L5].reset(new UnorderedListItemRenderer(5));
-	renderers[TAG_RENDERER_UNORDERED_LIST_ITEM_L6].reset(new UnorderedListItemRenderer(6));
-
-	html_no_line_breaks = var.reset(L"html_no_line_breaks", VAR_FALSE);
-	html_no_default_paragraphs = var.reset(L"html_no_default_paragraphs", VAR_FALSE);
-	html_no_shys = var.reset(L"html_no_shys", VAR_FALSE);
-	html_default_p_alignment = var.reset(L"html_default_p_alignment", L"aj");
-	html_embedded_css = var.reset(L"html_embedded_css", L"");
-	html_doc_title = var.reset(L"html_doc_title", L"");
-	html_body_class = var.reset(L"html_body_class", L"");
-	html_body_style = var.reset(L"html_body_style", L"");
-	html_h1_class = var.reset(L"html_h1_class", L"");
-	html_h1_style = var.reset(L"html_h1_style", L"");
-	html_h2_class = var.reset(L"html_h2_class", L"");
-	html_h2_style = var.reset(L"html_h2_style", L"");
-	html_h3_class = var.reset(L"html_h3_class", L"");
-	html_h3_style = var.reset(L"html_h3_style", L"");
-	html_h4_class = var.reset(L"html_h4_class", L"");
-	html_h4_style = var.reset(L"html_h4_style", L"");
-	html_h5_class = var.reset(L"html_h5_class", L"");
-	html_h5_style = var.reset(L"html_h5_style", L"");
-	html_h6_class = var.reset(L"html_h6_class", L"");
-	html_h6_style = var.reset(L"html_h6_style", L"");
-	html_p_class = var.reset(L"html_p_class", L"");
-	html_p_style = var.reset(L"html_p_style", L"");
-	html_cite_p_class = var.reset(L"html_cite_p_class", L"");
-	html_cite_p_style = var.reset(L"html_cite_p_style", L"");
-	html_cite_class = var.reset(L"html_cite_class", L"");
-	html_cite_style = var.reset(L"html_cite_style", L"");
-	html_verse_class = var.reset(L"html_verse_class", L"stml_verse");
-	html_verse_style = var.reset(L"html_verse_style", L"");
-	html_pre_class = var.reset(L"html_pre_class", L"");
-	html_pre_style = var.reset(L"html_pre_style", L"");
-	html_ol_class = var.reset(L"html_ol_class", L"");
-	html_ol_style = var.reset(L"html_ol_style", L"");
-	html_ul_class = var.reset(L"html_ul_class", L"");
-	html_ul_style = var.reset(L"html_ul_style", L"");
-	html_link_class = var.reset(L"html_link_class", L"");
-	html_link_style = var.reset(L"html_link_style", L"");
-	html_section_class = var.reset(L"html_section_class", L"");
-	html_section_style = var.reset(L"html_section_style", L"");
-	html_hr_class = var.reset(L"html_hr_class", L"");
-	html_hr_style = var.reset(L"html_hr_style", L"");
-	html_img_class = var.reset(L"html_img_class", L"");
-	html_img_style = var.reset(L"html_img_style", L"");
-	html_ol_ml_class = var.reset(L"html_ol_ml_class", L"");
-	html_ol_ml_style = var.reset(L"html_ol_ml_style", L"");
-	html_ul_ml_l1_class = var.reset(L"html_ul_ml_l1_class", L"");
-	html_ul_ml_l2_class = var.reset(L"html_ul_ml_l2_class", L"");
-	html_ul_ml_l3_class = var.reset(L"html_ul_ml_l3_class", L"");
-	html_ul_ml_l4_class = var.reset(L"html_ul_ml_l4_class", L"");
-	html_ul_ml_l5_class = var.reset(L"html_ul_ml_l5_class", L"");
-	html_ul_ml_l6_class = var.reset(L"html_ul_ml_l6_class", L"");
-	html_ul_ml_l1_style = var.reset(L"html_ul_ml_l1_style", L"");
-	html_ul_ml_l2_style = var.reset(L"html_ul_ml_l2_style", L"");
-	html_ul_ml_l3_style = var.reset(L"html_ul_ml_l3_style", L"");
-	html_ul_ml_l4_style = var.reset(L"html_ul_ml_l4_style", L"");
-	html_ul_ml_l5_style = var.reset(L"html_ul_ml_l5_style", L"");
-	html_ul_ml_l6_style = var.reset(L"html_ul_ml_l6_style", L"");
-	html_ul_li_l1_class = var.reset(L"html_ul_li_l1_class", L"");
-	html_ol_li_l1_class = var.reset(L"html_ol_li_l1_class", L"");
-	html_ul_li_l2_class = var.reset(L"html_ul_li_l2_class", L"");
-	html_ol_li_l2_class = var.reset(L"html_ol_li_l2_class", L"");
-	html_ul_li_l3_class = var.reset(L"html_ul_li_l3_class", L"");
-	html_ol_li_l3_class = var.reset(L"html_ol_li_l3_class", L"");
-	html_ul_li_l4_class = var.reset(L"html_ul_li_l4_class", L"");
-	html_ol_li_l4_class = var.reset(L"html_ol_li_l4_class", L"");
-	html_ul_li_l5_class = var.reset(L"html_ul_li_l5_class", L"");
-	html_ol_li_l5_class = var.reset(L"html_ol_li_l5_class", L"");
-	html_ul_li_l6_class = var.reset(L"html_ul_li_l6_class", L"");
-	html_ol_li_l6_class = var.reset(L"html_ol_li_l6_class", L"");
-	html_ul_li_l1_style = var.reset(L"html_ul_li_l1_style", L"");
-	html_ol_li_l1_style = var.reset(L"html_ol_li_l1_style", L"");
-	html_ul_li_l2_style = var.reset(L"html_ul_li_l2_style", L"");
-	html_ol_li_l2_style = var.reset(L"html_ol_li_l2_style", L"");
-	html_ul_li_l3_style = var.reset(L"html_ul_li_l3_style", L"");
-	html_ol_li_l3_style = var.reset(L"html_ol_li_l3_style", L"");
-	html_ul_li_l4_style = var.reset(L"html_ul_li_l4_style", L"");
-	html_ol_li_l4_style = var.reset(L"html_ol_li_l4_style", L"");
-	html_ul_li_l5_style = var.reset(L"html_ul_li_l5_style", L"");
-	html_ol_li_l5_style = var.reset(L"html_ol_li_l5_style", L"");
-	html_ul_li_l6_style = var.reset(L"html_ul_li_l6_style", L"");
-	html_ol_li_l6_style = var.reset(L"html_ol_li_l6_style", L"");
-	html_li_index_class = var.reset(L"html_li_index_class", L"");
-	html_li_index_style = var.reset(L"html_li_index_style", L"");
-	list_format = var.reset(L"list_format", DEFAULT_LIST_FORMAT);
 
 	continue_line = false;
 	current_inline_tag = NULL;
 	inline_tag_being_rednered = NULL;
 	document_opened = false;
+	toc = false;
 	current_var = UNKNOWN_VAR;
-	list_format_changed = false;
-	current_list_format.set(DEFAULT_LIST_FORMAT);
+	link_attributes_version = 1;
+
+	//The escapes are kept by the builder when it's cleared.
+	markup.set_escapes(&escape_table());
 }
 
 HtmlGenerator::~HtmlGenerator() {
-	map<wstring, HtmlGenerator::AbstractInlineTag*>::iterator i;
-	for (i = inline_tags.begin(); i != inline_tags.end(); ++i) {
-		delete (*i).second;
+	//Do nothing.
+}
+
+const VariablesManager& HtmlGenerator::variables() const {
+	return var;
+}
+
+void HtmlGenerator::set_variables(const VariablesManager& prototype) {
+	var = prototype;
+	++link_attributes_version;
+	list_index_open.clear();
+
+	for (int r = 0; r < TAG_RENDERERS_COUNT; ++r) {
+		for (int a = 0; a <= ALIGN_DEFAULT; ++a) {
+			open_tags[r][a].bytes.clear();
+		}
 	}
 }
 
-void HtmlGenerator::TagRenderer::write_attributes(
+bool HtmlGenerator::is_unquoted_value(const string& value) {
+	return !value.empty() && value.find_first_of(" \t\n\r\f\"'=<>`") == string::npos;
+}
+
+string HtmlGenerator::minify_tag(const string& tag) {
+	string minified;
+	minified.reserve(tag.length());
+
+	size_t i = tag.find_first_of(" />");
+	minified.append(tag, 0, i);
+
+	while (i < tag.length()) {
+		char c = tag[i];
+
+		if (c == ' ' || c == '/') {
+			++i;
+			continue;
+		}
+
+		if (c == '>') {
+			minified += '>';
+			break;
+		}
+
+		size_t eq = tag.find('=', i);
+		size_t value_start = eq + 2;
+		size_t value_end = tag.find(tag[eq + 1], value_start);
+
+		minified += ' ';
+		minified.append(tag, i, eq + 1 - i);
+
+		string value(tag, value_start, value_end - value_start);
+		if (is_unquoted_value(value)) {
+			minified += value;
+		} else {
+			minified.append(tag, eq + 1, value_end - eq);
+		}
+
+		i = value_end + 1;
+	}
+
+	return minified;
+}
+
+void HtmlGenerator::write_attributes(
 		ostream& out,
 		const char* attr_names[],
 		const char* attr_values[],
@@ -186,285 +290,227 @@ void HtmlGenerator::TagRenderer::write_attributes(
 	}
 }
 
-void HtmlGenerator::TagRenderer::write_open(
-		HtmlGenerator* generator,
-		const char* tag_name,
+void HtmlGenerator::write_open(
+		ostream& out,
+		TagRenderers renderer,
 		const char* attr_names[],
 		const char* attr_values[],
 		size_t attr_count,
 		bool end,
 		bool close
 	) {
-	*(generator->out) << "<" << tag_name << " ";
+	const TagRenderer& r = RENDERERS[renderer];
+
+	out << "<" << r.tag_name << " ";
 
 	bool exclude_class = false;
 	bool exclude_style = false;
 
-	var_id_t v = class_parameter(generator);
-	if (v != UNKNOWN_VAR && !generator->var[v].as_string().empty()) {
+	bool class_var_set = r.class_var != UNKNOWN_VAR && !var.get(r.class_var).empty();
+	bool style_var_set = r.style_var != UNKNOWN_VAR && !var.get(r.style_var).empty();
+
+	//The styles declared by the document header are written as their classes.
+	const string* renderer_style_class = NULL;
+	const string* attr_style_class = NULL;
+
+	if (!style_classes.empty()) {
+		string renderer_style(r.static_style);
+		if (style_var_set) {
+			renderer_style += var.get(r.style_var).as_utf8();
+		}
+
+		renderer_style_class = style_class(renderer_style);
 
-		*(generator->out) << "class='";
-		generator->var[v].markup.write(*(generator->out));
-		for (size_t i = 0; i < attr_count; ++i) {
-			if (char_traits<char>::compare(attr_names[i], "class", CLASS_STRLEN) == 0) {
-				*(generator->out) << attr_values[i];
-				exclude_class = true;
+		//An inline style would override the class of the attribute style.
+		for (size_t i = 0; i < attr_count && (renderer_style_class || renderer_style.empty()); ++i) {
+			if (char_traits<char>::compare(attr_names[i], "style", STYLE_STRLEN) == 0) {
+				attr_style_class = style_class(attr_values[i]);
 				break;
 			}
 		}
-		*(generator->out) << "' ";
 	}
 
-	const char* st_style = static_style();
+	if (class_var_set || renderer_style_class || attr_style_class) {
+		const char* separator = "";
 
-	v = style_parameter(generator);
-	bool style_var_set = v != UNKNOWN_VAR && !generator->var[v].as_string().empty();
+		out << "class='";
 
-	if (style_var_set || st_style[0]) {
+		if (class_var_set) {
+			out << var.get(r.class_var).as_utf8();
+			for (size_t i = 0; i < attr_count; ++i) {
+				if (char_traits<char>::compare(attr_names[i], "class", CLASS_STRLEN) == 0) {
+					out << attr_values[i];
+					exclude_class = true;
+					break;
+				}
+			}
+			separator = " ";
+		}
 
-		*(generator->out) << "style='";
+		if (renderer_style_class) {
+			out << separator << *renderer_style_class;
+			separator = " ";
+		}
 
-		if (st_style[0]) {
-			*(generator->out) << static_style();
+		if (attr_style_class) {
+			out << separator << *attr_style_class;
+			exclude_style = true;
+		}
+
+		out << "' ";
+	}
+
+	bool static_style_set = r.static_style[0] && !renderer_style_class;
+	style_var_set = style_var_set && !renderer_style_class;
+
+	if (style_var_set || static_style_set) {
+
+		out << "style='";
+
+		if (static_style_set) {
+			out << r.static_style;
 		}
 
 		if (style_var_set) {
-			generator->var[v].markup.write(*(generator->out));
+			out << var.get(r.style_var).as_utf8();
 		}
 
-		for (size_t i = 0; i < attr_count; ++i) {
+		for (size_t i = 0; i < attr_count && !exclude_style; ++i) {
 			if (char_traits<char>::compare(attr_names[i], "style", STYLE_STRLEN) == 0) {
-				*(generator->out) << attr_values[i];
+				out << attr_values[i];
 				exclude_style = true;
 				break;
 			}
 		}
-		*(generator->out) << "' ";
+		out << "' ";
 	}
 
-	write_attributes(*(generator->out), attr_names, attr_values, attr_count, exclude_class, exclude_style);
+	write_attributes(out, attr_names, attr_values, attr_count, exclude_class, exclude_style);
 
 	if (end) {
 		if (close) {
-			*(generator->out) << "/";
+			out << "/";
 		}
-		*(generator->out) << ">";
+		out << ">";
 	}
 }
 
-void HtmlGenerator::TagRenderer::write_close(ostream& out, const char* tag_name) {
-	out << "</" << tag_name << ">";
-}
-
-void HtmlGenerator::TagRenderer::open(
-	HtmlGenerator* generator,
-	const char* attr_names[],
-	const char* attr_values[],
-	size_t attr_count,
-	bool end,
-	bool close) {
-	write_open(generator, tag_name(), attr_names, attr_values, attr_count, end, close);
-}
-
-void HtmlGenerator::TagRenderer::line(HtmlGenerator* generator) {
-	if (generator->place_line_break) {
-		*(generator->out) << "<br/>";
-	}
-	generator->decorate_text();
-	generator->markup.write(*(generator->out));
-}
-
-void HtmlGenerator::TagRenderer::close(HtmlGenerator* generator) {
-	write_close(*(generator->out), tag_name());
-}
-
-const char* HtmlGenerator::TagRenderer::static_style() const {
-	return "";
-}
-
-const char* HtmlGenerator::HeaderRenderer::tag_name() {
-	static const char* names[] = { "h1", "h2", "h3", "h4", "h5", "h6" };
-	return names[level - 1];
-}
-
-var_id_t HtmlGenerator::HeaderRenderer::class_parameter(HtmlGenerator* generator) {
-	var_id_t vars[] = {
-		generator->html_h1_class, generator->html_h2_class,
-		generator->html_h3_class, generator->html_h4_class,
-		generator->html_h5_class, generator->html_h6_class
-	};
-
-	return vars[level - 1];
-}
-
-var_id_t HtmlGenerator::HeaderRenderer::style_parameter(HtmlGenerator* generator) {
-	var_id_t vars[] = {
-		generator->html_h1_style, generator->html_h2_style,
-		generator->html_h3_style, generator->html_h4_style,
-		generator->html_h5_style, generator->html_h6_style
-	};
-
-	return vars[level - 1];
-}
-
-void HtmlGenerator::CiteRenderer::line(HtmlGenerator* generator) {
-
-}
-
-void HtmlGenerator::PreformatedRenderer::line(HtmlGenerator* generator) {
-	if (generator->place_line_break) {
-		*(generator->out) << endl;
+void HtmlGenerator::render_line(TagRenderers renderer) {
+	switch (RENDERERS[renderer].line_mode) {
+	case LINE_TEXT:
+		if (place_line_break) {
+			*out << (minify() ? "<br>" : "<br/>");
+		}
+		write_decorated(markup, text_decoration());
+		break;
+	case LINE_PREFORMATED:
+		if (place_line_break) {
+			*out << endl;
+		}
+		markup.write(*out);
+		break;
+	case LINE_LIST_ITEM:
+		if (!markup.empty()) {
+			*out << "<li>";
+			markup.write(*out);
+			*out << "</li>";
+		}
+		break;
+	case LINE_IMAGE:
+		switch (image_tag_line) {
+		case IMAGE_TAG_LINE_URL:
+			write_image_attribute("src");
+			image_tag_line = IMAGE_TAG_LINE_ALT;
+			break;
+		case IMAGE_TAG_LINE_ALT:
+			write_image_attribute("alt");
+			image_tag_line = IMAGE_TAG_LINE_IGNORE;
+			break;
+		case IMAGE_TAG_LINE_IGNORE:
+			//Do nothing.
+			break;
+		}
+		break;
+	case LINE_NONE:
+		//Do nothing.
+		break;
 	}
-
-	generator->markup.write(*(generator->out));
 }
 
-void HtmlGenerator::OrderedListRenderer::line(HtmlGenerator* generator) {
-	if (!generator->markup.empty()) {
-		*(generator->out) << "<li>";
-		generator->markup.write(*(generator->out));
-		*(generator->out) << "</li>";
-	}
-}
+void HtmlGenerator::write_image_attribute(const char* name) {
+	if (minify()) {
+		string value;
+		markup.append(value);
 
-void HtmlGenerator::UnorderedListRenderer::line(HtmlGenerator* generator) {
-	if (!generator->markup.empty()) {
-		*(generator->out) << "<li>";
-		generator->markup.write(*(generator->out));
-		*(generator->out) << "</li>";
+		*out << " " << name << "=";
+		if (is_unquoted_value(value)) {
+			*out << value;
+		} else {
+			*out << "'" << value << "'";
+		}
+	} else {
+		*out << name << "='";
+		markup.write(*out);
+		*out << "' ";
 	}
 }
 
-void HtmlGenerator::SectionRenderer::line(HtmlGenerator* generator) {
-
-}
-
-void HtmlGenerator::ImageRenderer::line(HtmlGenerator* generator) {
-	switch (generator->image_tag_line) {
-	case IMAGE_TAG_LINE_URL:
-		*(generator->out) << "src='";
-		generator->markup.write(*(generator->out));
-		*(generator->out) << "' ";
-		generator->image_tag_line = IMAGE_TAG_LINE_ALT;
-		break;
-	case IMAGE_TAG_LINE_ALT:
-		*(generator->out) << "alt='";
-		generator->markup.write(*(generator->out));
-		*(generator->out) << "' ";
-		generator->image_tag_line = IMAGE_TAG_LINE_IGNORE;
-		break;
-	case IMAGE_TAG_LINE_IGNORE:
-		//Do nothing.
-		break;
+void HtmlGenerator::render_close(TagRenderers renderer) {
+	if (RENDERERS[renderer].line_mode == LINE_IMAGE) {
+		//The image is an empty element; its attributes are written by the lines.
+		*out << (minify() ? ">" : "/>");
+	} else {
+		*out << "</" << RENDERERS[renderer].tag_name << ">";
 	}
 }
 
-void HtmlGenerator::ImageRenderer::close(HtmlGenerator* generator) {
-	*(generator->out) << "/>";
-}
-
 void HtmlGenerator::AbstractInlineTag::append_markup_to_value(const MarkupBuilder& markup) {
 	markup.append(value);
 }
 
-void HtmlGenerator::LinkInlineTag::open(HtmlGenerator* generator) {
-	buffer.clear();
+void HtmlGenerator::LinkInlineTag::append_markup_to_value(const MarkupBuilder& markup) {
+	AbstractInlineTag::append_markup_to_value(markup);
+	anchor_version = 0;
+}
+
+void HtmlGenerator::LinkInlineTag::render_anchor(HtmlGenerator* generator) {
+	string buffer;
 	buffer += "<a href='";
 	buffer += value;
 	buffer += "' ";
 
-	wstring link_class = generator->var[generator->html_link_class].as_string();
-	if (!link_class.empty()) {
-		buffer += "class='";
-		append_wchar_to_utf8(buffer, link_class.c_str());
-		buffer += "' ";
-	}
-
-	wstring link_style = generator->var[generator->html_link_style].as_string();
-	if (!link_style.empty()) {
-		buffer += "style='";
-		append_wchar_to_utf8(buffer, link_style.c_str());
-		buffer += "' ";
-	}
+	generator->append_class_and_style(
+		buffer,
+		generator->var.get(VAR_HTML_LINK_CLASS).as_utf8(),
+		generator->var.get(VAR_HTML_LINK_STYLE).as_utf8()
+	);
 
 	buffer += ">";
-	generator->markup.next_char().prepend(buffer.c_str());
-}
-
-void HtmlGenerator::LinkInlineTag::close(HtmlGenerator* generator) {
-	generator->markup.last_char().append("</a>");
-}
-
-void HtmlGenerator::OrderedMultilevelListRenderer::line(HtmlGenerator* generator) {
-	//Do nothing.
-}
-
-void HtmlGenerator::UnorderedMultilevelListRenderer::line(HtmlGenerator* generator) {
-	//Do nothing.
-}
-
-var_id_t HtmlGenerator::UnorderedMultilevelListRenderer::class_parameter(HtmlGenerator* generator) {
-	var_id_t vars[] = {
-		generator->html_ul_ml_l1_class, generator->html_ul_ml_l2_class,
-		generator->html_ul_ml_l3_class, generator->html_ul_ml_l4_class,
-		generator->html_ul_ml_l5_class, generator->html_ul_ml_l6_class
-	};
-
-	return vars[level - 1];
-}
-
-var_id_t HtmlGenerator::UnorderedMultilevelListRenderer::style_parameter(HtmlGenerator* generator) {
-	var_id_t vars[] = {
-		generator->html_ul_ml_l1_style, generator->html_ul_ml_l2_style,
-		generator->html_ul_ml_l3_style, generator->html_ul_ml_l4_style,
-		generator->html_ul_ml_l5_style, generator->html_ul_ml_l6_style
-	};
 
-	return vars[level - 1];
-}
-
-var_id_t HtmlGenerator::OrderedListItemRenderer::class_parameter(HtmlGenerator* generator) {
-	var_id_t vars[] = {
-		generator->html_ol_li_l1_class, generator->html_ol_li_l2_class,
-		generator->html_ol_li_l3_class, generator->html_ol_li_l4_class,
-		generator->html_ol_li_l5_class, generator->html_ol_li_l6_class
-	};
-
-	return vars[level - 1];
-}
-
-var_id_t HtmlGenerator::OrderedListItemRenderer::style_parameter(HtmlGenerator* generator) {
-	var_id_t vars[] = {
-		generator->html_ol_li_l1_style, generator->html_ol_li_l2_style,
-		generator->html_ol_li_l3_style, generator->html_ol_li_l4_style,
-		generator->html_ol_li_l5_style, generator->html_ol_li_l6_style
-	};
+	if (generator->minify()) {
+		buffer = minify_tag(buffer);
+	}
 
-	return vars[level - 1];
+	anchor.swap(buffer);
+	anchor_version = generator->link_attributes_version;
 }
 
-const char* HtmlGenerator::OrderedListItemRenderer::static_style() const {
-	return "list-style-type: none;list-style-image: none;";
+void HtmlGenerator::LinkInlineTag::complete(HtmlGenerator* generator) {
+	render_anchor(generator);
 }
 
-var_id_t HtmlGenerator::UnorderedListItemRenderer::class_parameter(HtmlGenerator* generator) {
-	var_id_t vars[] = {
-		generator->html_ul_li_l1_class, generator->html_ul_li_l2_class,
-		generator->html_ul_li_l3_class, generator->html_ul_li_l4_class,
-		generator->html_ul_li_l5_class, generator->html_ul_li_l6_class
-	};
+void HtmlGenerator::LinkInlineTag::open(HtmlGenerator* generator) {
+	if (anchor_version != generator->link_attributes_version) {
+		render_anchor(generator);
+	}
 
-	return vars[level - 1];
+	generator->markup.next_char().prepend_inline(anchor);
 }
 
-var_id_t HtmlGenerator::UnorderedListItemRenderer::style_parameter(HtmlGenerator* generator) {
-	var_id_t vars[] = {
-		generator->html_ul_li_l1_style, generator->html_ul_li_l2_style,
-		generator->html_ul_li_l3_style, generator->html_ul_li_l4_style,
-		generator->html_ul_li_l5_style, generator->html_ul_li_l6_style
-	};
+void HtmlGenerator::LinkInlineTag::close(HtmlGenerator* generator) {
+	static const decoration_id_t end_of_anchor = DecorationTable::intern("</a>");
 
-	return vars[level - 1];
+	generator->markup.last_char().append(end_of_anchor);
 }
 
 void HtmlGenerator::document() {
@@ -479,7 +525,24 @@ void HtmlGenerator::header(int level) {
 	}
 
 	TagRenderers renderer = (TagRenderers) ((int) TAG_RENDERER_HEADER1 + ((level < 0) ? 0 : level - 1));
-	renderers[renderer]->open(this, NULL, NULL, 0, true, false);
+	begin_index_entry(OutputIndex::INDEX_ENTRY_HEADER, (level < 0) ? 1 : level, tag_stack.size());
+
+	if (toc) {
+		//The header is the target of its link in the table of contents.
+		TocEntry entry;
+		entry.level = (level < 0) ? 1 : level;
+		toc_entries.push_back(entry);
+
+		open_tag(renderer, ALIGN_DEFAULT, false, false);
+
+		if (minify()) {
+			*out << " id=stml_h" << toc_entries.size() << ">";
+		} else {
+			*out << "id='stml_h" << toc_entries.size() << "'>";
+		}
+	} else {
+		open_tag(renderer, ALIGN_DEFAULT, true, false);
+	}
 	tag_stack.push(renderer);
 	place_line_break = false;
 }
@@ -501,18 +564,65 @@ const char* HtmlGenerator::alignment_css(Alignments alignment) {
 
 void HtmlGenerator::open_aligned_tag(TagRenderers renderer, Alignments alignment) {
 	Alignments effective_alignment =
-			(alignment != ALIGN_DEFAULT) ? alignment : parse_alignment(
-					var[html_default_p_alignment].as_string());
+			(alignment != ALIGN_DEFAULT) ? alignment : var.get(VAR_HTML_DEFAULT_P_ALIGNMENT).as_alignment();
+
+	open_tag(renderer, effective_alignment, true, false);
+}
+
+void HtmlGenerator::open_tag(TagRenderers renderer, Alignments alignment, bool end, bool close) {
+	OpenTag& tag = open_tags[renderer][alignment];
 
-	const char* attr_values[1];
-	attr_values[0] = alignment_css(effective_alignment);
+	if (tag.bytes.empty() || tag.end != end || tag.close != close) {
+		ostringstream rendered;
+		const char* attr_names[] = { "style" };
+		const char* attr_values[] = { (alignment != ALIGN_DEFAULT) ? alignment_css(alignment) : NULL };
+
+		write_open(rendered, renderer, attr_names, attr_values, (alignment != ALIGN_DEFAULT) ? 1 : 0, end, close);
 
-	const char* attr_names[] = { "style" };
+		tag.bytes = minify() ? minify_tag(rendered.str()) : rendered.str();
+		tag.end = end;
+		tag.close = close;
+	}
 
-	renderers[renderer]->open(this, attr_names, attr_values, 1, true, false);
+	out->write(tag.bytes.data(), tag.bytes.size());
+}
+
+void HtmlGenerator::invalidate_open_tags(var_id_t v) {
+	if (v >= VARIABLES_COUNT) {
+		//Only the built-in variables are used by the renderers.
+		return;
+	}
+
+	if (v == VAR_HTML_LINK_CLASS || v == VAR_HTML_LINK_STYLE) {
+		++link_attributes_version;
+	}
+
+	if (v == VAR_HTML_LI_INDEX_CLASS || v == VAR_HTML_LI_INDEX_STYLE || v == VAR_HTML_MINIFY) {
+		list_index_open.clear();
+	}
+
+	if (v == VAR_HTML_MINIFY) {
+		++link_attributes_version;
+
+		for (int r = 0; r < TAG_RENDERERS_COUNT; ++r) {
+			for (int a = 0; a <= ALIGN_DEFAULT; ++a) {
+				open_tags[r][a].bytes.clear();
+			}
+		}
+	}
+
+	for (int r = 0; r < TAG_RENDERERS_COUNT; ++r) {
+		if (RENDERERS[r].class_var == v || RENDERERS[r].style_var == v) {
+			for (int a = 0; a <= ALIGN_DEFAULT; ++a) {
+				open_tags[r][a].bytes.clear();
+			}
+		}
+	}
 }
 
 void HtmlGenerator::paragraph(Alignments alignment) {
+	begin_block_entry();
+
 	if (tag_stack.empty() || tag_stack.top() != TAG_RENDERER_CITE) {
 		open_aligned_tag(TAG_RENDERER_PARAGRAPH, alignment);
 		tag_stack.push(TAG_RENDERER_PARAGRAPH);
@@ -524,49 +634,59 @@ void HtmlGenerator::paragraph(Alignments alignment) {
 }
 
 void HtmlGenerator::link(const wstring& name) {
-	map<wstring, HtmlGenerator::AbstractInlineTag*>::iterator tag = inline_tags.find(name);
-	if (tag != inline_tags.end()) {
+	pair<unordered_map<wstring, AbstractInlineTag*>::iterator, bool> tag =
+		inline_tags.insert(make_pair(name, (AbstractInlineTag*)NULL));
+
+	if (!tag.second) {
 		throw StmlException(StmlException::INLINE_TAG_ALREADY_EXISTS);
 	}
 
-	current_inline_tag = new HtmlGenerator::LinkInlineTag(name);
-	inline_tags[name] = current_inline_tag;
+	links.push_back(LinkInlineTag(name));
+	current_inline_tag = &links.back();
+	tag.first->second = current_inline_tag;
 
 	tag_stack.push(TAG_RENDERER_LINK);
 	place_line_break = false;
 }
 
 void HtmlGenerator::cite(Alignments alignment) {
-	renderers[TAG_RENDERER_CITE]->open(this, NULL, NULL, 0, true, false);
+	begin_block_entry();
+	open_tag(TAG_RENDERER_CITE, ALIGN_DEFAULT, true, false);
 	tag_stack.push(TAG_RENDERER_CITE);
 	place_line_break = false;
 }
 
 void HtmlGenerator::verse() {
-	renderers[TAG_RENDERER_VERSE]->open(this, NULL, NULL, 0, true, false);
+	begin_block_entry();
+	open_tag(TAG_RENDERER_VERSE, ALIGN_DEFAULT, true, false);
 	tag_stack.push(TAG_RENDERER_VERSE);
 	place_line_break = false;
 }
 
 void HtmlGenerator::preformated() {
-	renderers[TAG_RENDERER_PREFORMATED]->open(this, NULL, NULL, 0, true, false);
+	begin_block_entry();
+	open_tag(TAG_RENDERER_PREFORMATED, ALIGN_DEFAULT, true, false);
 	tag_stack.push(TAG_RENDERER_PREFORMATED);
 	place_line_break = false;
 }
 
 void HtmlGenerator::line_break() {
-	renderers[TAG_RENDERER_LINE_BREAK]->open(this, NULL, NULL, 0, true, true);
+	begin_block_entry();
+	open_tag(TAG_RENDERER_LINE_BREAK, ALIGN_DEFAULT, true, true);
+	end_index_entries(tag_stack.size());
 	place_line_break = false;
 }
 
 void HtmlGenerator::ordered_list() {
-	renderers[TAG_RENDERER_ORDERED_LIST]->open(this, NULL, NULL, 0, true, false);
+	begin_block_entry();
+	open_tag(TAG_RENDERER_ORDERED_LIST, ALIGN_DEFAULT, true, false);
 	tag_stack.push(TAG_RENDERER_ORDERED_LIST);
 	place_line_break = false;
 }
 
 void HtmlGenerator::unordered_list() {
-	renderers[TAG_RENDERER_UNORDERED_LIST]->open(this, NULL, NULL, 0, true, false);
+	begin_block_entry();
+	open_tag(TAG_RENDERER_UNORDERED_LIST, ALIGN_DEFAULT, true, false);
 	tag_stack.push(TAG_RENDERER_UNORDERED_LIST);
 	place_line_break = false;
 }
@@ -577,13 +697,16 @@ void HtmlGenerator::comment() {
 }
 
 void HtmlGenerator::section() {
-	renderers[TAG_RENDERER_SECTION]->open(this, NULL, NULL, 0, true, false);
+	begin_index_entry(OutputIndex::INDEX_ENTRY_SECTION, 0, tag_stack.size());
+	open_tag(TAG_RENDERER_SECTION, ALIGN_DEFAULT, true, false);
 	tag_stack.push(TAG_RENDERER_SECTION);
 	place_line_break = false;
 }
 
 void HtmlGenerator::horizontal_line() {
-	renderers[TAG_RENDERER_HORIZONTAL_LINE]->open(this, NULL, NULL, 0, true, true);
+	begin_block_entry();
+	open_tag(TAG_RENDERER_HORIZONTAL_LINE, ALIGN_DEFAULT, true, true);
+	end_index_entries(tag_stack.size());
 	place_line_break = false;
 }
 
@@ -591,17 +714,8 @@ void HtmlGenerator::variable(const wstring& name) {
 	current_var = UNKNOWN_VAR;
 
 	if (!name.empty()) {
-		current_var = var.get_by_name(name.c_str());
-
-		if (current_var == UNKNOWN_VAR) {
-			current_var = var.reset(name.c_str(), L"");
-		} else {
-			var[current_var].markup.clear();
-		}
-
-		if (name == L"list_format") {
-			list_format_changed = true;
-		}
+		current_var = var.reset(name.c_str(), L"");
+		invalidate_open_tags(current_var);
 	}
 	tag_stack.push(TAG_RENDERER_VARIABLE);
 	place_line_break = false;
@@ -637,48 +751,156 @@ void HtmlGenerator::image(ImageSize* size, Alignments alignment) {
 		image_style.append("float:right;");
 	}
 
+	begin_block_entry();
+
 	if (!image_style.empty()) {
 		const char* attr_names[] = { "style" };
 		const char* attr_values[1];
 
 		attr_values[0] = image_style.c_str();
 
-		renderers[TAG_RENDERER_IMAGE]->open(this, attr_names, attr_values, 1, false, false);
+		if (minify()) {
+			ostringstream rendered;
+			write_open(rendered, TAG_RENDERER_IMAGE, attr_names, attr_values, 1, false, false);
+			*out << minify_tag(rendered.str());
+		} else {
+			write_open(*out, TAG_RENDERER_IMAGE, attr_names, attr_values, 1, false, false);
+		}
 	} else {
-		renderers[TAG_RENDERER_IMAGE]->open(this, NULL, NULL, 0, false, false);
+		open_tag(TAG_RENDERER_IMAGE, ALIGN_DEFAULT, false, false);
 	}
 
 	tag_stack.push(TAG_RENDERER_IMAGE);
 	place_line_break = false;
 }
 
+void HtmlGenerator::declare_style_classes(ostream& css) {
+	style_classes.clear();
+
+	vector<string> styles;
+
+	for (int r = 0; r < TAG_RENDERERS_COUNT; ++r) {
+		if (RENDERERS[r].tag_name) {
+			string style(RENDERERS[r].static_style);
+
+			if (RENDERERS[r].style_var != UNKNOWN_VAR) {
+				style += var.get(RENDERERS[r].style_var).as_utf8();
+			}
+
+			styles.push_back(style);
+		}
+	}
+
+	styles.push_back(var.get(VAR_HTML_LINK_STYLE).as_utf8());
+	styles.push_back(var.get(VAR_HTML_LI_INDEX_STYLE).as_utf8());
+
+	//The alignments are declared last, so they override the styles of the renderers.
+	for (int a = ALIGN_LEFT; a < ALIGN_DEFAULT; ++a) {
+		styles.push_back(alignment_css((Alignments)a));
+	}
+
+	for (vector<string>::const_iterator style = styles.begin(); style != styles.end(); ++style) {
+		if (style->empty() || style_classes.count(*style)) {
+			continue;
+		}
+
+		ostringstream name;
+		name << "stml_s" << style_classes.size();
+
+		style_classes[*style] = name.str();
+		css << "." << name.str() << "{" << *style << "}";
+	}
+
+	//The tags rendered so far have the styles inline.
+	for (int r = 0; r < TAG_RENDERERS_COUNT; ++r) {
+		for (int a = 0; a <= ALIGN_DEFAULT; ++a) {
+			open_tags[r][a].bytes.clear();
+		}
+	}
+
+	++link_attributes_version;
+	list_index_open.clear();
+}
+
+const string* HtmlGenerator::style_class(const string& style) const {
+	unordered_map<string, string>::const_iterator found = style_classes.find(style);
+	return (found != style_classes.end()) ? &found->second : NULL;
+}
+
+void HtmlGenerator::append_class_and_style(string& buffer, const string& class_value, const string& style_value) const {
+	const string* declared_class = style_value.empty() ? NULL : style_class(style_value);
+
+	if (!class_value.empty() || declared_class) {
+		buffer += "class='";
+		buffer += class_value;
+
+		if (declared_class) {
+			if (!class_value.empty()) {
+				buffer += " ";
+			}
+			buffer += *declared_class;
+		}
+
+		buffer += "' ";
+	}
+
+	if (!style_value.empty() && !declared_class) {
+		buffer += "style='";
+		buffer += style_value;
+		buffer += "' ";
+	}
+}
+
 void HtmlGenerator::generate_doc_header() {
-	*out << "<html><head>";
-	*out << "<meta http-equiv=\"Content-Type\" content=\"text/html; charset=UTF-8\">";
-	if (!var[html_doc_title].as_string().empty()) {
-		*out << "<title>";
-		var[html_doc_title].markup.write(*out);
-		*out << "</title>";
-	}
-	if (!var[html_embedded_css].as_string().empty()) {
-		*out << "<style type='text/css'>";
-		var[html_embedded_css].markup.write(*out);
-		*out << "</style>";
+	bool browser_hyphenation = var.get(VAR_HTML_BROWSER_HYPHENATION).as_boolean();
+
+	bool minified = minify();
+
+	if (browser_hyphenation) {
+		//The browser hyphenates the words by the rules of the language.
+		const char* quote = minified ? "" : "\"";
+		*out << "<html lang=" << quote << language->code() << quote << "><head>";
+	} else {
+		*out << "<html><head>";
 	}
-	*out << "</head>";
 
-	*out << "<body ";
-	if (!var[html_body_class].as_string().empty()) {
-		*out << "class='";
-		var[html_body_class].markup.write(*out);
-		*out << "' ";
+	if (minified) {
+		*out << "<meta charset=utf-8>";
+	} else {
+		*out << "<meta http-equiv=\"Content-Type\" content=\"text/html; charset=UTF-8\">";
 	}
-	if (!var[html_body_style].as_string().empty()) {
-		*out << "style='";
-		var[html_body_style].markup.write(*out);
-		*out << "' ";
+	if (!var.get(VAR_HTML_DOC_TITLE).empty()) {
+		*out << "<title>" << var.get(VAR_HTML_DOC_TITLE).as_utf8() << "</title>";
+	}
+	ostringstream css;
+	if (browser_hyphenation) {
+		css << HTML_BROWSER_HYPHENATION_CSS;
+	}
+	if (var.get(VAR_HTML_STYLE_CLASSES).as_boolean()) {
+		declare_style_classes(css);
+	}
+
+	toc = var.get(VAR_HTML_TOC).as_boolean();
+	if (toc) {
+		css << HTML_TOC_CSS;
+	}
+
+	if (!var.get(VAR_HTML_EMBEDDED_CSS).empty() || !css.str().empty()) {
+		*out << (minified ? "<style>" : "<style type='text/css'>");
+		*out << var.get(VAR_HTML_EMBEDDED_CSS).as_utf8() << css.str() << "</style>";
+	}
+	*out << "</head>";
+
+	string body("<body ");
+	append_class_and_style(body, var.get(VAR_HTML_BODY_CLASS).as_utf8(), var.get(VAR_HTML_BODY_STYLE).as_utf8());
+	body += ">";
+
+	*out << (minified ? minify_tag(body) : body);
+
+	//The contents are written before the text, when all the headers are known.
+	if (toc) {
+		hold_output();
 	}
-	*out << ">";
 }
 
 void HtmlGenerator::close_tag() {
@@ -699,32 +921,39 @@ void HtmlGenerator::close_tag() {
 	if (top < TAG_RENDERER_ORDERED_LIST_ITEM_L1 || top > TAG_RENDERER_UNORDERED_LIST_ITEM_L6) {
 		//If there is a renderer for the tag currently on top,
 		//render closing tag.
-		if (renderers[top].get()) {
-			renderers[top]->close(this);
+		if (RENDERERS[top].tag_name) {
+			render_close(top);
 
-			if (!var[html_no_line_breaks].as_boolean()) {
+			if (!var.get(VAR_HTML_NO_LINE_BREAKS).as_boolean() && !minify()) {
 				*out << endl;
 			}
 		}
 
 		tag_stack.pop();
+		end_index_entries(tag_stack.size());
 
-		current_var = UNKNOWN_VAR;
+		if (current_var != UNKNOWN_VAR) {
+			invalidate_open_tags(current_var);
+			current_var = UNKNOWN_VAR;
+		}
 	}
 
-	current_inline_tag = NULL;
+	if (current_inline_tag) {
+		current_inline_tag->complete(this);
+		current_inline_tag = NULL;
+	}
 }
 
 void HtmlGenerator::inject_variable(const wstring& variable_name) {
 	try {
-		markup << var[variable_name].markup;
+		markup << var.get(variable_name).markup;
 	} catch(const out_of_range&) {
 		throw StmlException(StmlException::VARIABLE_NOT_DECLARED);
 	}
 }
 
 void HtmlGenerator::open_inline_tag(const wstring& tag_name) {
-	map<wstring, HtmlGenerator::AbstractInlineTag*>::iterator tag = inline_tags.find(tag_name);
+	unordered_map<wstring, AbstractInlineTag*>::iterator tag = inline_tags.find(tag_name);
 
 	if (tag != inline_tags.end()) {
 		inline_tag_being_rednered = (*tag).second;
@@ -746,62 +975,61 @@ void HtmlGenerator::text_char(wchar_t c) {
 	}
 
 	markup << c;
-
-	if (c == L'&') {
-		markup.substitute(markup.last_char_index(), 1, "&amp;");
-	} else if (c == L'<') {
-		markup.substitute(markup.last_char_index(), 1, "&lt;");
-	} else if (c == L'>') {
-		markup.substitute(markup.last_char_index(), 1, "&gt;");
-	}
 }
 
 void HtmlGenerator::open_bold() {
-	markup.next_char().prepend("<b>");
+	static const decoration_id_t bold_open = DecorationTable::intern("<b>");
+
+	markup.next_char().prepend(bold_open);
 }
 
 void HtmlGenerator::close_bold() {
-	markup.last_char().append("</b>");
+	static const decoration_id_t bold_close = DecorationTable::intern("</b>");
+
+	markup.last_char().append(bold_close);
 }
 
 void HtmlGenerator::open_italic() {
-	markup.next_char().prepend("<i>");
+	static const decoration_id_t italic_open = DecorationTable::intern("<i>");
+
+	markup.next_char().prepend(italic_open);
 }
 
 void HtmlGenerator::close_italic() {
-	markup.last_char().append("</i>");
+	static const decoration_id_t italic_close = DecorationTable::intern("</i>");
+
+	markup.last_char().append(italic_close);
 }
 
 void HtmlGenerator::stress_mark() {
-	markup.last_char().append(HTML_STRESS_MARK);
+	static const decoration_id_t utf8_stress_mark = DecorationTable::intern(HTML_UTF8_STRESS_MARK);
+	static const decoration_id_t entity_stress_mark = DecorationTable::intern(HTML_STRESS_MARK);
+
+	markup.last_char().append(var.get(VAR_HTML_NO_ENTITIES).as_boolean() ? utf8_stress_mark : entity_stress_mark);
 }
 
 void HtmlGenerator::line_continue() {
 	continue_line = true;
 }
 
-void HtmlGenerator::decorate_text() {
-	wstring text = markup.get_text();
-
-	language->process_punctuation(markup, HTML_DASH, quotes);
-
+TextDecoration HtmlGenerator::text_decoration() const {
 	TagRenderers top_tag = (tag_stack.empty()) ? TAG_RENDERER_PARAGRAPH
 			: tag_stack.top();
 
-	if (!var[html_no_shys].as_boolean() && top_tag
-			!= TAG_RENDERER_PREFORMATED && !(top_tag >= TAG_RENDERER_HEADER1
-			&& top_tag <= TAG_RENDERER_HEADER6)) {
+	TextDecoration decoration = {
+		language.get(),
+		var.get(VAR_HTML_NO_ENTITIES).as_boolean() ? &utf8_typography() : &typography(),
+		HYPHENATE_WORDS
+	};
 
-		tokenizer->reset();
-		while (tokenizer->next_token(text)) {
-			Tokenizer::Token current_token = tokenizer->get_current_token();
+	if (var.get(VAR_HTML_NO_SHYS).as_boolean() || var.get(VAR_HTML_BROWSER_HYPHENATION).as_boolean()
+			|| top_tag == TAG_RENDERER_PREFORMATED || (top_tag >= TAG_RENDERER_HEADER1
+			&& top_tag <= TAG_RENDERER_HEADER6)) {
 
-			if (current_token.type == WORD_TOKEN) {
-				language->hyphenate(markup, current_token.start,
-						current_token.length, HTML_SHY);
-			}
-		}
+		decoration.hyphenation = HYPHENATE_NONE;
 	}
+
+	return decoration;
 }
 
 void HtmlGenerator::line_end() {
@@ -810,9 +1038,16 @@ void HtmlGenerator::line_end() {
 		//If we are in root, section or cite,
 		//render default paragraph or, if $no_default_paragraphs specified, plain text.
 
-		if (var[html_no_default_paragraphs].as_boolean()) {
+		if (var.get(VAR_HTML_NO_DEFAULT_PARAGRAPHS).as_boolean()) {
 			markup.write(*out);
-			*out << endl;
+			//The line break separates the words of the lines, so it is kept when minified.
+			if (minify()) {
+				if (!markup.empty()) {
+					*out << '\n';
+				}
+			} else {
+				*out << endl;
+			}
 			markup.clear();
 		} else if (!markup.empty()) {
 			paragraph(ALIGN_DEFAULT);
@@ -825,10 +1060,23 @@ void HtmlGenerator::line_end() {
 			var[current_var].markup << markup;
 		} else {
 			TagRenderers top = tag_stack.top();
+
+			if (top >= TAG_RENDERER_HEADER1 && top <= TAG_RENDERER_HEADER6) {
+				append_index_text(markup.get_text());
+
+				if (toc && !toc_entries.empty() && !markup.empty()) {
+					wstring& text = toc_entries.back().text;
+					if (!text.empty()) {
+						text += L' ';
+					}
+					text += markup.get_text();
+				}
+			}
+
 			//If there is a renderer for the tag currently on top,
 			//render the line within the tag.
-			if (renderers[top].get()) {
-				renderers[top]->line(this);
+			if (RENDERERS[top].tag_name) {
+				render_line(top);
 			}
 
 			//If it is not specified explicitly that the line must be continued,
@@ -843,15 +1091,77 @@ void HtmlGenerator::line_end() {
 
 void HtmlGenerator::close_document() {
 	if (document_opened) {
+		if (toc) {
+			ostringstream toc_out;
+			if (!toc_entries.empty()) {
+				write_toc(toc_out);
+			}
+			release_output(toc_out.str());
+		}
+
 		*out << "</body></html>";
 	}
 }
 
+void HtmlGenerator::write_toc(ostream& toc_out) {
+	bool minified = minify();
+
+	toc_out << (minified ? "<nav id=stml_toc><ul>" : "<nav id='stml_toc'><ul>");
+
+	for (size_t i = 0; i < toc_entries.size(); ++i) {
+		if (minified) {
+			toc_out << "<li class=stml_toc_h" << toc_entries[i].level << "><a href=#stml_h" << i + 1 << ">";
+		} else {
+			toc_out << "<li class='stml_toc_h" << toc_entries[i].level << "'><a href='#stml_h" << i + 1 << "'>";
+		}
+
+		const wstring& text = toc_entries[i].text;
+		for (wstring::const_iterator c = text.begin(); c != text.end(); ++c) {
+			const char* sequence = escape_table().sequence(*c);
+
+			if (sequence) {
+				toc_out << sequence;
+			} else {
+				write_utf8_char(*c, toc_out);
+			}
+		}
+
+		toc_out << "</a></li>";
+	}
+
+	toc_out << "</ul></nav>";
+
+	if (!minified) {
+		toc_out << endl;
+	}
+}
+
 void HtmlGenerator::refresh_list_format() {
-	if (list_format_changed) {
-		current_list_format.set(var[list_format].as_string().c_str());
-		list_format_changed = false;
+	shared_ptr<const ListFormat> format = var.get(VAR_LIST_FORMAT).as_list_format();
+
+	if (format != current_list_format) {
+		current_list_format = format;
+		list_indexes.clear();
+	}
+}
+
+void HtmlGenerator::render_list_index_open() {
+	string buffer;
+	buffer += "<span ";
+
+	append_class_and_style(
+		buffer,
+		var.get(VAR_HTML_LI_INDEX_CLASS).as_utf8(),
+		var.get(VAR_HTML_LI_INDEX_STYLE).as_utf8()
+	);
+
+	buffer += ">";
+
+	if (minify()) {
+		buffer = minify_tag(buffer);
 	}
+
+	list_index_open.swap(buffer);
 }
 
 void HtmlGenerator::ordered_list_item(int level) {
@@ -869,27 +1179,28 @@ void HtmlGenerator::ordered_list_item(int level) {
 		int pops_count = (current_level - level) * 2 + 1;
 
 		for (int i = 0; i < pops_count; ++i) {
-			renderers[tag_stack.top()]->close(this);
+			render_close(tag_stack.top());
 			tag_stack.pop();
 		}
 
 		TagRenderers item_renderer = (TagRenderers)(TAG_RENDERER_ORDERED_LIST_ITEM_L1 + level - 1);
 
-		renderers[item_renderer]->open(this, NULL, NULL, 0, true, false);
+		open_tag(item_renderer, ALIGN_DEFAULT, true, false);
 		tag_stack.push(item_renderer);
 	} else if (level > current_level) {
-		renderers[TAG_RENDERER_ORDERED_ML_LIST]->open(this, NULL, NULL, 0, true, false);
+		begin_block_entry();
+		open_tag(TAG_RENDERER_ORDERED_ML_LIST, ALIGN_DEFAULT, true, false);
 		tag_stack.push(TAG_RENDERER_ORDERED_ML_LIST);
 
 		TagRenderers item_renderer = (TagRenderers)(TAG_RENDERER_ORDERED_LIST_ITEM_L1 + level - 1);
 
-		renderers[item_renderer]->open(this, NULL, NULL, 0, true, false);
+		open_tag(item_renderer, ALIGN_DEFAULT, true, false);
 		tag_stack.push(item_renderer);
 	} else {
 		TagRenderers item_renderer = tag_stack.top();
 
-		renderers[item_renderer]->close(this);
-		renderers[item_renderer]->open(this, NULL, NULL, 0, true, false);
+		render_close(item_renderer);
+		open_tag(item_renderer, ALIGN_DEFAULT, true, false);
 	}
 
 	place_line_break = false;
@@ -897,20 +1208,24 @@ void HtmlGenerator::ordered_list_item(int level) {
 
 	refresh_list_format();
 
-	markup << L"<span ";
-
-	if (!var[html_li_index_class].markup.empty()) {
-		markup << L"class='" << var[html_li_index_class].markup << L"' ";
+	if (list_indexes.size() < (size_t)level) {
+		list_indexes.resize(level);
 	}
 
-	if (!var[html_li_index_style].markup.empty()) {
-		markup << L"style='" << var[html_li_index_style].markup << L"' ";
+	ListIndex& index = list_indexes[level - 1];
+	current_list_format->generator(level)->update_index(list_items_counter.current_item_path(), index);
+
+	if (list_index_open.empty()) {
+		render_list_index_open();
 	}
 
-	markup
-		<< L">"
-		<< current_list_format.generator(level)->generate_index(list_items_counter.current_item_path())
-		<< L"</span>";
+	static const decoration_id_t list_index_close = DecorationTable::intern("</span>");
+
+	markup.set_escapes(NULL);
+	markup.next_char().prepend_inline(list_index_open);
+	markup << index.text.c_str();
+	markup.last_char().append(list_index_close);
+	markup.set_escapes(&escape_table());
 }
 
 void HtmlGenerator::unordered_list_item(int level) {
@@ -928,29 +1243,30 @@ void HtmlGenerator::unordered_list_item(int level) {
 		int pops_count = (current_level - level) * 2 + 1;
 
 		for (int i = 0; i < pops_count; ++i) {
-			renderers[tag_stack.top()]->close(this);
+			render_close(tag_stack.top());
 			tag_stack.pop();
 		}
 
 		TagRenderers item_renderer = (TagRenderers)(TAG_RENDERER_UNORDERED_LIST_ITEM_L1 + level - 1);
 
-		renderers[item_renderer]->open(this, NULL, NULL, 0, true, false);
+		open_tag(item_renderer, ALIGN_DEFAULT, true, false);
 		tag_stack.push(item_renderer);
 	} else if (level > current_level) {
 		TagRenderers list_renderer = (TagRenderers)(TAG_RENDERER_UNORDERED_ML_LIST_L1 + level - 1);
 
-		renderers[list_renderer]->open(this, NULL, NULL, 0, true, false);
+		begin_block_entry();
+		open_tag(list_renderer, ALIGN_DEFAULT, true, false);
 		tag_stack.push(list_renderer);
 
 		TagRenderers item_renderer = (TagRenderers)(TAG_RENDERER_UNORDERED_LIST_ITEM_L1 + level - 1);
 
-		renderers[item_renderer]->open(this, NULL, NULL, 0, true, false);
+		open_tag(item_renderer, ALIGN_DEFAULT, true, false);
 		tag_stack.push(item_renderer);
 	} else {
 		TagRenderers item_renderer = tag_stack.top();
 
-		renderers[item_renderer]->close(this);
-		renderers[item_renderer]->open(this, NULL, NULL, 0, true, false);
+		render_close(item_renderer);
+		open_tag(item_renderer, ALIGN_DEFAULT, true, false);
 	}
 
 	place_line_break = false;
@@ -964,10 +1280,11 @@ void HtmlGenerator::terminator() {
 		int pops_count = list_items_counter.current_item_path().size() * 2;
 
 		for (int i = 0; i < pops_count; ++i) {
-			renderers[tag_stack.top()]->close(this);
+			render_close(tag_stack.top());
 			tag_stack.pop();
 		}
 
 		list_items_counter.reset();
+		end_index_entries(tag_stack.size());
 	}
 }
@@ -10,21 +10,54 @@
 using namespace std;
 using namespace stml;
 
+//In the order of TexGenerator::Variables.
+const VariablesManager::Default TexGenerator::DEFAULT_VARIABLES[TexGenerator::VARIABLES_COUNT] = {
+    { L"tex_chapter_line_skip", L"" },
+    { L"tex_chapter_subtitle_format", L"" },
+    { L"tex_chapter_numbers", VAR_FALSE },
+    { L"tex_section_numbers", VAR_FALSE },
+    { L"tex_subsection_numbers", VAR_FALSE },
+    { L"tex_subsubsection_numbers", VAR_FALSE },
+    { L"tex_br_size", L"10pt" },
+    { L"tex_hr_width", L"100pt" },
+    { L"tex_hr_height", L"1pt" },
+    { L"tex_toc", VAR_FALSE },
+};
+
+const VariablesManager& TexGenerator::default_variables() {
+    static const VariablesManager defaults(DEFAULT_VARIABLES, VARIABLES_COUNT);
+    return defaults;
+}
+
+const Typography& TexGenerator::typography() {
+    //In the order of QuoteTypes.
+    static const char* const quotes[QUOTE_TYPES_COUNT] = { NULL, "<<", ">>", ",,", "''", "``", "''", "`", "'" };
+    static const Typography tex_typography(quotes, TEX_DASH, TEX_SHY);
+    return tex_typography;
+}
+
+const EscapeTable& TexGenerator::escape_table() {
+    static const EscapeTable::Escape escapes[] = {
+        { L'#', "\\#" },
+        { L'$', "\\$" },
+        { L'%', "\\%" },
+        { L'^', "\\^" },
+        { L'&', "\\&" },
+        { L'_', "\\_" },
+        { L'{', "\\{" },
+        { L'}', "\\}" },
+        { L'~', "\\~" },
+        { L'\\', "\\textbackslash" }
+    };
+    static const EscapeTable tex_escapes(escapes, sizeof(escapes) / sizeof(escapes[0]));
+    return tex_escapes;
+}
+
 TexGenerator::TexGenerator()
-    : AbstractGenerator() {
+    : AbstractGenerator(), var(default_variables()) {
 
     //TODO: Multiple languages support.
     language.reset(new RussianLanguage());
-    tokenizer.reset(language->create_tokenizer());
-
-    quotes[QUOTE_FRENCH_OPENED] = "<<";
-    quotes[QUOTE_FRENCH_CLOSED] = ">>";
-    quotes[QUOTE_ENGLISH_OPENED] = "``";
-    quotes[QUOTE_ENGLISH_CLOSED] = "''";
-    quotes[QUOTE_GERMAN_OPENED] = ",,";
-    quotes[QUOTE_GERMAN_CLOSED] = "''";
-    quotes[QUOTE_ENGLISH_SINGLE_OPENED] = "`";
-    quotes[QUOTE_ENGLISH_SINGLE_CLOSED] = "'";
 
     renderers[TEX_RENDERER_CHAPTER].reset(new ChaperRenderer());
     renderers[TEX_RENDERER_SECTION].reset(new CommandRenderer("section"));
@@ -38,31 +71,29 @@ TexGenerator::TexGenerator()
     renderers[TEX_RENDERER_ENUMERATE].reset(new ListRenderer("enumerate"));
     renderers[TEX_RENDERER_IMAGE].reset(new CommandRenderer("includegraphics"));
 
-    tex_chapter_line_skip = var.reset(L"tex_chapter_line_skip", L"");
-    tex_chapter_subtitle_format = var.reset(L"tex_chapter_subtitle_format", L"");
-    tex_chapter_numbers = var.reset(L"tex_chapter_numbers", VAR_FALSE);
-    tex_section_numbers = var.reset(L"tex_section_numbers", VAR_FALSE);
-    tex_subsection_numbers = var.reset(L"tex_subsection_numbers", VAR_FALSE);
-    tex_subsubsection_numbers = var.reset(L"tex_subsubsection_numbers", VAR_FALSE);
-    tex_br_size = var.reset(L"tex_br_size", L"10pt");
-    tex_hr_width = var.reset(L"tex_hr_width", L"100pt");
-    tex_hr_height = var.reset(L"tex_hr_height", L"1pt");
-
     continue_line = false;
     current_var = UNKNOWN_VAR;
+    markup.set_escapes(&escape_table());
 }
 
 TexGenerator::~TexGenerator() {
 	//Do nothing.
 }
 
+const VariablesManager& TexGenerator::variables() const {
+    return var;
+}
+
+void TexGenerator::set_variables(const VariablesManager& prototype) {
+    var = prototype;
+}
+
 void TexGenerator::TexRenderer::line(TexGenerator* generator) {
     if (generator->place_line_break) {
         *(generator->out) << "\\\\";
     }
 
-    generator->decorate_text();
-    generator->markup.write(*(generator->out));
+    generator->write_decorated(generator->markup, generator->text_decoration());
 }
 
 void TexGenerator::ParagraphRenderer::end(TexGenerator* generator) {
@@ -91,19 +122,16 @@ void TexGenerator::ChaperRenderer::line(TexGenerator* generator) {
     if (generator->place_line_break) {
         *(generator->out) << "\\\\";
 
-        if (!generator->var[generator->tex_chapter_line_skip].empty()) {
-            *(generator->out) << "[";
-            generator->var[generator->tex_chapter_line_skip].markup.write(*(generator->out));
-            *(generator->out) << "]";
+        if (!generator->var.get(VAR_TEX_CHAPTER_LINE_SKIP).empty()) {
+            *(generator->out) << "[" << generator->var.get(VAR_TEX_CHAPTER_LINE_SKIP).as_utf8() << "]";
         }
 
-        if (!generator->var[generator->tex_chapter_subtitle_format].empty()) {
-            generator->var[generator->tex_chapter_subtitle_format].markup.write(*(generator->out));
+        if (!generator->var.get(VAR_TEX_CHAPTER_SUBTITLE_FORMAT).empty()) {
+            *(generator->out) << generator->var.get(VAR_TEX_CHAPTER_SUBTITLE_FORMAT).as_utf8();
         }
     }
 
-    generator->decorate_text();
-    generator->markup.write(*(generator->out));
+    generator->write_decorated(generator->markup, generator->text_decoration());
 }
 
 void TexGenerator::EnvironmentRenderer::begin(TexGenerator* generator) {
@@ -137,24 +165,25 @@ void TexGenerator::header(int level) {
     switch (level) {
     case 1:
         renderer = TEX_RENDERER_CHAPTER;
-        starred = var[tex_chapter_numbers].as_boolean();
+        starred = var.get(VAR_TEX_CHAPTER_NUMBERS).as_boolean();
         break;
     case 2:
         renderer = TEX_RENDERER_SECTION;
-        starred = var[tex_section_numbers].as_boolean();
+        starred = var.get(VAR_TEX_SECTION_NUMBERS).as_boolean();
         break;
     case 3:
         renderer = TEX_RENDERER_SUBSECTION;
-        starred = var[tex_subsection_numbers].as_boolean();
+        starred = var.get(VAR_TEX_SUBSECTION_NUMBERS).as_boolean();
         break;
     case 4:
         renderer = TEX_RENDERER_SUBSUBSECTION;
-        starred = var[tex_subsubsection_numbers].as_boolean();
+        starred = var.get(VAR_TEX_SUBSUBSECTION_NUMBERS).as_boolean();
         break;
     default:
         throw StmlException(StmlException::UNSUPPORTED_HEADER_LEVEL);
     }
 
+    begin_index_entry(OutputIndex::INDEX_ENTRY_HEADER, level, tag_stack.size());
     tag_stack.push(renderer);
     ((CommandRenderer*)renderers[renderer].get())->begin(this, NULL, starred);
 
@@ -162,6 +191,7 @@ void TexGenerator::header(int level) {
 }
 
 void TexGenerator::paragraph(Alignments alignment) {
+    begin_block_entry();
     tag_stack.push(TEX_RENDERER_PARAGRAPH);
     place_line_break = false;
 }
@@ -172,39 +202,46 @@ void TexGenerator::link(const wstring& name) {
 }
 
 void TexGenerator::cite(Alignments alignment) {
+    begin_block_entry();
     tag_stack.push(TEX_RENDERER_QUOTATION);
     ((EnvironmentRenderer*)renderers[TEX_RENDERER_QUOTATION].get())->begin(this);
     place_line_break = false;
 }
 
 void TexGenerator::verse() {
+    begin_block_entry();
     tag_stack.push(TEX_RENDERER_VERSE);
     ((EnvironmentRenderer*)renderers[TEX_RENDERER_VERSE].get())->begin(this);
     place_line_break = false;
 }
 
 void TexGenerator::preformated() {
+    begin_block_entry();
     tag_stack.push(TEX_RENDERER_VERBATIM);
     ((EnvironmentRenderer*)renderers[TEX_RENDERER_VERBATIM].get())->begin(this);
     place_line_break = false;
 }
 
 void TexGenerator::line_break() {
-    *out << "\\vspace{";
-    var[tex_br_size].markup.write(*out);
-    *out << "}"
+    begin_block_entry();
+    *out << "\\vspace{"
+    	 << var.get(VAR_TEX_BR_SIZE).as_utf8()
+    	 << "}"
     	 << endl
     	 << endl;
+    end_index_entries(tag_stack.size());
     place_line_break = false;
 }
 
 void TexGenerator::ordered_list() {
+    begin_block_entry();
     tag_stack.push(TEX_RENDERER_ENUMERATE);
     ((EnvironmentRenderer*)renderers[TEX_RENDERER_ENUMERATE].get())->begin(this);
     place_line_break = false;
 }
 
 void TexGenerator::unordered_list() {
+    begin_block_entry();
     tag_stack.push(TEX_RENDERER_ITEMIZE);
     ((EnvironmentRenderer*)renderers[TEX_RENDERER_ITEMIZE].get())->begin(this);
     place_line_break = false;
@@ -216,16 +253,19 @@ void TexGenerator::comment() {
 }
 
 void TexGenerator::section() {
+    begin_index_entry(OutputIndex::INDEX_ENTRY_SECTION, 0, tag_stack.size());
     tag_stack.push(TEX_RENDERER_STML_SECTION);
     place_line_break = false;
 }
 
 void TexGenerator::horizontal_line() {
-    *out << "\\rule{";
-    var[tex_hr_width].markup.write(*out);
-	*out << "}{";
-	var[tex_hr_height].markup.write(*out);
-	*out << "}" << endl << endl;
+    begin_block_entry();
+    *out << "\\rule{"
+    	 << var.get(VAR_TEX_HR_WIDTH).as_utf8()
+    	 << "}{"
+    	 << var.get(VAR_TEX_HR_HEIGHT).as_utf8()
+    	 << "}" << endl << endl;
+    end_index_entries(tag_stack.size());
     place_line_break = false;
 }
 
@@ -233,15 +273,12 @@ void TexGenerator::variable(const wstring& name) {
 	current_var = UNKNOWN_VAR;
 
 	if (!name.empty()) {
-		current_var = var.get_by_name(name.c_str());
-
-		if (current_var == UNKNOWN_VAR) {
-			current_var = var.reset(name.c_str(), L"");
-		} else {
-			var[current_var].markup.clear();
-		}
+		current_var = var.reset(name.c_str(), L"");
 	}
 
+    //Variable values are not escaped as they may have parts of TeX.
+    markup.set_escapes(current_var == UNKNOWN_VAR ? &escape_table() : NULL);
+
     tag_stack.push(TEX_RENDERER_VARIABLE);
     place_line_break = false;
 }
@@ -279,6 +316,7 @@ void TexGenerator::image(ImageSize* size, Alignments alignment) {
 
 	attr_writer.set_size(size);
 
+    begin_block_entry();
     tag_stack.push(TEX_RENDERER_IMAGE);
     ((CommandRenderer*)renderers[TEX_RENDERER_IMAGE].get())->begin(this, &attr_writer, false);
     place_line_break = false;
@@ -295,6 +333,11 @@ void TexGenerator::close_tag() {
 
     TexRenderers top = tag_stack.top();
 
+    if (top == TEX_RENDERER_DOCUMENT && var.get(VAR_TEX_TOC).as_boolean()) {
+        //TeX collects the headers itself and puts the contents here.
+        *out << "\\tableofcontents" << endl << endl;
+    }
+
     if (top != TEX_RENDERER_ITEMIZE && top != TEX_RENDERER_ENUMERATE) {
 		//If there is a renderer for the tag currently on top,
 		//render closing tag.
@@ -303,14 +346,16 @@ void TexGenerator::close_tag() {
 		}
 
 		tag_stack.pop();
+		end_index_entries(tag_stack.size());
     }
 
     current_var = UNKNOWN_VAR;
+    markup.set_escapes(&escape_table());
 }
 
 void TexGenerator::inject_variable(const wstring& variable_name) {
 	try {
-		markup << var[variable_name].markup;
+		markup << var.get(variable_name).markup;
 	} catch(const out_of_range&) {
 		throw StmlException(StmlException::VARIABLE_NOT_DECLARED);
 	}
@@ -331,95 +376,46 @@ void TexGenerator::text_char(wchar_t c) {
     }
 
     markup << c;
-
-    //Variable values are not escaped as they may have parts of TeX.
-    if (current_var == UNKNOWN_VAR) {
-        if (std::char_traits<wchar_t>::find(L"#$%^&_{}~", 9, c)) {
-            char escape_sequence[3] = "\\ ";
-            escape_sequence[1] = c;
-            markup.substitute(markup.last_char_index(), 1, escape_sequence);
-        }
-        else if (c == L'\\') {
-            markup.substitute(markup.last_char_index(), 1, "\\textbackslash");
-        }
-    }
 }
 
 void TexGenerator::open_bold() {
-    markup.next_char().prepend("{\\bfseries ");
+    static const decoration_id_t bold_open = DecorationTable::intern("{\\bfseries ");
+
+    markup.next_char().prepend(bold_open);
 }
 
 void TexGenerator::close_bold() {
-    markup.last_char().append("}");
+    static const decoration_id_t group_close = DecorationTable::intern("}");
+
+    markup.last_char().append(group_close);
 }
 
 void TexGenerator::open_italic() {
-    markup.next_char().prepend("{\\em ");
+    static const decoration_id_t italic_open = DecorationTable::intern("{\\em ");
+
+    markup.next_char().prepend(italic_open);
 }
 
 void TexGenerator::close_italic() {
-    markup.last_char().append("}");
+    static const decoration_id_t group_close = DecorationTable::intern("}");
+
+    markup.last_char().append(group_close);
 }
 
 void TexGenerator::stress_mark() {
-    markup.last_char().prepend("\\'");
+    static const decoration_id_t accent = DecorationTable::intern("\\'");
+
+    markup.last_char().prepend(accent);
 }
 
 void TexGenerator::line_continue() {
     continue_line = true;
 }
 
-void TexGenerator::decorate_text() {
-    language->process_punctuation(markup, TEX_DASH, quotes);
-
+TextDecoration TexGenerator::text_decoration() const {
     //Explicitly hyphenate words containing hyphens.
-    wstring text = markup.get_text();
-    tokenizer->reset();
-    bool after_word = false;
-    bool hyphenate_next_word = false;
-    size_t word_start, word_len;
-
-    while (tokenizer->next_token(text)) {
-        Tokenizer::Token current_token = tokenizer->get_current_token();
-
-        if (current_token.type == WORD_TOKEN) {
-            word_start = current_token.start;
-            word_len = current_token.length;
-            after_word = true;
-
-            if (hyphenate_next_word) {
-                language->hyphenate(
-                    markup,
-                    word_start,
-                    word_len,
-                    TEX_SHY
-                );
-                hyphenate_next_word = false;
-            }
-        } else if (current_token.type == SINGLE_CHAR_TOKEN) {
-            if (after_word && text[current_token.start] == L'-') {
-                language->hyphenate(
-                    markup,
-                    word_start,
-                    word_len,
-                    TEX_SHY
-                );
-                hyphenate_next_word = true;
-            }
-            after_word = false;
-        } else if (current_token.type == WHITESPACE_TOKEN) {
-            if (after_word && hyphenate_next_word) {
-                language->hyphenate(
-                    markup,
-                    word_start,
-                    word_len,
-                    TEX_SHY
-                );
-                hyphenate_next_word = false;
-            }
-            after_word = false;
-        }
-    }
+    TextDecoration decoration = { language.get(), &typography(), HYPHENATE_COMPOUND_WORDS };
+    return decoration;
 }
 
 void TexGenerator::line_end() {
@@ -436,6 +432,11 @@ void TexGenerator::line_end() {
             var[current_var].markup << markup;
         } else {
             TexRenderers top = tag_stack.top();
+
+            if (top >= TEX_RENDERER_CHAPTER && top <= TEX_RENDERER_SUBSUBSECTION) {
+                append_index_text(markup.get_text());
+            }
+
             //If there is a renderer for the tag currently on top,
             //render the line within tag.
             if (renderers[top].get()) {
@@ -479,6 +480,7 @@ void TexGenerator::ml_list(TexRenderers renderer, int level) {
 			tag_stack.pop();
 		}
 	} else if (level > current_level) {
+		begin_block_entry();
 		((EnvironmentRenderer*)renderers[renderer].get())->begin(this);
 		tag_stack.push(renderer);
 	}
@@ -507,5 +509,6 @@ void TexGenerator::terminator() {
 		}
 
 		list_items_counter.reset();
+		end_index_entries(tag_stack.size());
 	}
 }
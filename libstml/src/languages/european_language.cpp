@@ -7,44 +7,97 @@
 using namespace stml;
 using namespace std;
 
-inline void substitute_quote(
-    QuoteTypes quote,
+void EuropeanLanguage::decorate(
     MarkupBuilder& builder,
-    size_t at,
-    const map<int,string>& quotes) {
+    const Typography& typography,
+    HyphenationModes hyphenation) const {
 
-    map<int,string>::const_iterator q = quotes.find((int)quote);
-    if (quotes.find(quote) != quotes.end()) {
-        builder.substitute(at, 1, q->second.c_str());
+    //The substitutions don't change the text, so it is read in place.
+    const wstring& txt = builder.get_text();
+    size_t length = txt.length();
+    bool quote_alt = false;
+
+    //Without hyphenation the words don't matter, so only the quotes
+    //and the hyphens are looked at.
+    if (hyphenation == HYPHENATE_NONE) {
+        for (size_t i = txt.find_first_of(L"\"-"); i != wstring::npos; i = txt.find_first_of(L"\"-", i + 1)) {
+            substitute_punctuation(builder, i, typography, quote_alt);
+        }
+        return;
     }
-}
 
-void EuropeanLanguage::process_punctuation(
-    MarkupBuilder& builder,
-    const char* dash,
-    const map<int,string>& quotes) const {
+    //The last word seen and whether it's followed by a hyphen or a space.
+    size_t word_start = 0;
+    size_t word_length = 0;
+    bool after_word = false;
+    bool hyphenate_next_word = false;
 
-    wstring txt = builder.get_text();
-    bool quote_alt = false;
+    bool word_char = length > 0 && is_word_char(txt[0]);
 
-    for(size_t i = 0; i < txt.length(); ++i) {
-        switch (txt[i]) {
-        case L'"':
-            QuoteTypes qt;
-            if (i < txt.length() - 1 && is_word_char(txt[i + 1])) {
-                qt = (quote_alt) ? opened_alt_quote() : opened_quote();
-            }
-            else {
-                qt = (!quote_alt) ? closed_alt_quote() : closed_quote();
+    for(size_t i = 0; i < length; ++i) {
+        bool next_word_char = i + 1 < length && is_word_char(txt[i + 1]);
+
+        if (word_char) {
+            if (!after_word || word_start + word_length != i) {
+                word_start = i;
+                word_length = 0;
             }
-            quote_alt = !quote_alt;
-            substitute_quote(qt, builder, i, quotes);
-            break;
-        case L'-':
-            if (i < txt.length() - 1 && txt[i + 1] == L' ') {
-                builder.substitute(i, 1, dash);
+            ++word_length;
+            after_word = true;
+
+            if (!next_word_char) {
+                if (hyphenation == HYPHENATE_WORDS || hyphenate_next_word) {
+                    hyphenate(builder, word_start, word_length, typography.shy());
+                    hyphenate_next_word = false;
+                }
             }
-            break;
+
+            word_char = next_word_char;
+            continue;
+        }
+
+        if (txt[i] == L'"' || txt[i] == L'-') {
+            substitute_punctuation(builder, i, typography, quote_alt);
+        }
+
+        if (txt[i] == L'-' && hyphenation == HYPHENATE_COMPOUND_WORDS && after_word) {
+            hyphenate(builder, word_start, word_length, typography.shy());
+            hyphenate_next_word = true;
         }
+
+        //Line breaks don't separate the word from the following hyphen.
+        if (txt[i] != L'\n') {
+            after_word = false;
+        }
+
+        word_char = next_word_char;
+    }
+}
+
+void EuropeanLanguage::substitute_punctuation(
+    MarkupBuilder& builder,
+    size_t i,
+    const Typography& typography,
+    bool& quote_alt) const {
+
+    const wstring& txt = builder.get_text();
+    size_t length = txt.length();
+
+    if (txt[i] == L'"') {
+        QuoteTypes qt;
+        if (i + 1 < length && is_word_char(txt[i + 1])) {
+            qt = (quote_alt) ? opened_alt_quote() : opened_quote();
+        }
+        else {
+            qt = (!quote_alt) ? closed_alt_quote() : closed_quote();
+        }
+        quote_alt = !quote_alt;
+
+        if (typography.quote(qt) != DecorationTable::NONE) {
+            builder[i].substitute(typography.quote(qt));
+        }
+    }
+    else if (txt[i] == L'-' && i < length - 1 && txt[i + 1] == L' ') {
+        builder[i].substitute(typography.dash());
     }
 }
@@ -107,8 +107,8 @@ bool RussianLanguage::is_word_char(wchar_t c) const {
     return RussianLanguage::is_cyrillic(c) || EuropeanLanguage::is_latin(c);
 }
 
-void RussianLanguage::hyphenate(MarkupBuilder& builder, size_t start, size_t length, const char* shy) const {
-    const wstring text = builder.get_text();
+void RussianLanguage::hyphenate(MarkupBuilder& builder, size_t start, size_t length, decoration_id_t shy) const {
+    const wstring& text = builder.get_text();
 
     if (is_acronym(text, start, length)) {
         return;
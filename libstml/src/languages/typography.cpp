@@ -0,0 +1,12 @@
+#include "../../include/languages/typography.hpp"
+
+using namespace stml;
+
+Typography::Typography(const char* const quotes[QUOTE_TYPES_COUNT], const char* dash, const char* shy) {
+    for (int q = 0; q < QUOTE_TYPES_COUNT; ++q) {
+        quote_ids[q] = quotes[q] ? DecorationTable::intern(quotes[q]) : DecorationTable::NONE;
+    }
+
+    dash_id = DecorationTable::intern(dash);
+    shy_id = DecorationTable::intern(shy);
+}
@@ -2,9 +2,29 @@
 #include "../include/list_format.hpp"
 #include "../include/stml_exception.hpp"
 
+#include <unordered_map>
+#include <mutex>
+
 using namespace std;
 using namespace stml;
 
+namespace {
+
+struct ParsedFormats {
+	//Formats come from the documents, so the cache is limited.
+	static const size_t MAX_FORMATS = 256;
+
+	mutex lock;
+	unordered_map<wstring, shared_ptr<const ListFormat> > formats;
+};
+
+ParsedFormats& parsed_formats() {
+	static ParsedFormats cache;
+	return cache;
+}
+
+}
+
 ListFormat::ListFormat() {
 	for (size_t i = 0; i < MAX_GENERATORS; ++i) {
 		generators[i] = NULL;
@@ -135,7 +155,7 @@ void ListFormat::set(const wchar_t* format) {
 	}
 }
 
-AbstractListIndexGenerator* ListFormat::generator(int level) const {
+const AbstractListIndexGenerator* ListFormat::generator(int level) const {
 	if (level < 1 || level > generators_count) {
 		throw StmlException(StmlException::FORMAT_IS_NOT_SET_FOR_LIST_LEVEL);
 	}
@@ -143,5 +163,29 @@ AbstractListIndexGenerator* ListFormat::generator(int level) const {
 	return generators[level - 1];
 }
 
+shared_ptr<const ListFormat> ListFormat::parse(const wstring& format) {
+	ParsedFormats& cache = parsed_formats();
 
+	{
+		lock_guard<mutex> guard(cache.lock);
 
+		unordered_map<wstring, shared_ptr<const ListFormat> >::const_iterator found = cache.formats.find(format);
+		if (found != cache.formats.end()) {
+			return found->second;
+		}
+	}
+
+	//Parsed without the lock; if another thread parses the same
+	//format meanwhile, the format cached first is used.
+	ListFormat* parsed = new ListFormat();
+	shared_ptr<const ListFormat> result(parsed);
+	parsed->set(format.c_str());
+
+	lock_guard<mutex> guard(cache.lock);
+
+	if (cache.formats.size() < ParsedFormats::MAX_FORMATS) {
+		result = cache.formats.insert(make_pair(format, result)).first->second;
+	}
+
+	return result;
+}
@@ -1,65 +1,104 @@
 #include "../include/list_index_generators.hpp"
 #include "../include/stml_exception.hpp"
+#include "../include/list_index_tables.hpp"
 
-#include <cstdio>
+#include <limits>
 
 using namespace std;
 using namespace stml;
 
+void AbstractListIndexGenerator::update_last_number(
+		const vector<int>& item_path,
+		ListIndex& index,
+		wchar_t left_bracket,
+		wchar_t right_bracket) const {
+
+	int number = item_path.empty() ? 0 : item_path.back();
+
+	if (!index.path.empty() && index.path[0] == number) {
+		return;
+	}
+
+	index.clear();
+
+	if (left_bracket) {
+		index.text += left_bracket;
+	}
+
+	if (!item_path.empty() && !append_number(index.text, number)) {
+		index.clear();
+		throw StmlException(StmlException::LIST_INDEX_OVERFLOW);
+	}
+
+	if (right_bracket) {
+		index.text += right_bracket;
+	}
+
+	if (index.text.length() > MAX_INDEX_LENGTH) {
+		index.clear();
+		throw StmlException(StmlException::LIST_INDEX_OVERFLOW);
+	}
+
+	index.path.push_back(number);
+}
+
 NumericListIndexGenerator::NumericListIndexGenerator()
 	: AbstractListIndexGenerator() {
 }
 
-int NumericListIndexGenerator::write_to_buffer(int at, int number) {
+bool NumericListIndexGenerator::append_number(wstring& text, int number) const {
 	if (number < 0) {
-		return -1;
+		return false;
 	}
 
 	static const int radix = 10;
 
-	int num = number;
-	int last = at - 1;
-	while (num) {
-		++last;
-		num /= radix;
-
-		if (last == BUFFER_SIZE - 1) {
-			return -1;
-		}
-	}
+	wchar_t digits[std::numeric_limits<int>::digits10 + 1];
+	size_t i = sizeof(digits) / sizeof(wchar_t);
 
-	int i = last;
 	while (number) {
-		buffer[i--] = L'0' + (wchar_t)(number % radix);
+		digits[--i] = L'0' + (wchar_t)(number % radix);
 		number /= radix;
 	}
 
-	return last + 1;
+	text.append(digits + i, sizeof(digits) / sizeof(wchar_t) - i);
+	return true;
 }
 
 MultiLevelNumericListIndexGenerator::MultiLevelNumericListIndexGenerator()
 	: NumericListIndexGenerator() {
 }
 
-const wchar_t* MultiLevelNumericListIndexGenerator::generate_index(const vector<int>& item_path) {
-	init_buffer();
-	int i = 0;
+void MultiLevelNumericListIndexGenerator::update_index(const vector<int>& item_path, ListIndex& index) const {
+	size_t level = 0;
+	while (level < index.path.size() && level < item_path.size() && index.path[level] == item_path[level]) {
+		++level;
+	}
+
+	if (level == index.path.size() && level == item_path.size()) {
+		return;
+	}
 
-	for(vector<int>::const_iterator lvl = item_path.begin(); lvl != item_path.end(); ++lvl) {
-		i = write_to_buffer(i, *lvl);
+	index.path.resize(level);
+	index.ends.resize(level);
+	index.text.resize(level > 0 ? index.ends.back() : 0);
 
-		if (i < 0) {
+	for (; level < item_path.size(); ++level) {
+		if (!append_number(index.text, item_path[level])) {
+			index.clear();
 			throw StmlException(StmlException::LIST_INDEX_OVERFLOW);
 		}
 
-		buffer[i++] = L'.';
+		index.text += L'.';
 
-		if (i == BUFFER_SIZE) {
+		if (index.text.length() > MAX_INDEX_LENGTH) {
+			index.clear();
 			throw StmlException(StmlException::LIST_INDEX_OVERFLOW);
 		}
-	}
 
-	return buffer;
+		index.path.push_back(item_path[level]);
+		index.ends.push_back(index.text.length());
+	}
 }
 
 SingleLevelListIndexGenerator::SingleLevelListIndexGenerator(wchar_t left_bracket, wchar_t right_bracket)
@@ -69,23 +108,8 @@ SingleLevelListIndexGenerator::SingleLevelListIndexGenerator(wchar_t left_bracke
 	this->right_bracket = right_bracket;
 }
 
-const wchar_t* SingleLevelListIndexGenerator::generate_index(const vector<int>& item_path) {
-	init_buffer();
-	int i = 0;
-
-	if (left_bracket) {
-		buffer[i++] = left_bracket;
-	}
-
-	if (!item_path.empty()) {
-		i = write_to_buffer(i, *(item_path.end() - 1));
-	}
-
-	if (right_bracket) {
-		buffer[i++] = right_bracket;
-	}
-
-	return buffer;
+void SingleLevelListIndexGenerator::update_index(const vector<int>& item_path, ListIndex& index) const {
+	update_last_number(item_path, index, left_bracket, right_bracket);
 }
 
 BracketedIndexGenerator::BracketedIndexGenerator(
@@ -96,31 +120,8 @@ BracketedIndexGenerator::BracketedIndexGenerator(
 	this->right_bracket = right_bracket;
 }
 
-const wchar_t* BracketedIndexGenerator::generate_index(const vector<int>& item_path) {
-	init_buffer();
-	int i = 0;
-
-	if (left_bracket) {
-		buffer[i++] = left_bracket;
-	}
-
-	if (!item_path.empty()) {
-		i = write_to_buffer(i, *(item_path.end() - 1));
-
-		if (i < 0 || i == BUFFER_SIZE) {
-			throw StmlException(StmlException::LIST_INDEX_OVERFLOW);
-		}
-	}
-
-	if (right_bracket) {
-		buffer[i++] = right_bracket;
-
-		if (i == BUFFER_SIZE) {
-			throw StmlException(StmlException::LIST_INDEX_OVERFLOW);
-		}
-	}
-
-	return buffer;
+void BracketedIndexGenerator::update_index(const vector<int>& item_path, ListIndex& index) const {
+	update_last_number(item_path, index, left_bracket, right_bracket);
 }
 
 CharRangeIndexGenerator::CharRangeIndexGenerator(
@@ -133,36 +134,43 @@ CharRangeIndexGenerator::CharRangeIndexGenerator(
 	this->range_end = range_end;
 }
 
-int CharRangeIndexGenerator::write_to_buffer(int at, int number) {
+bool CharRangeIndexGenerator::append_number(wstring& text, int number) const {
 	if (number < 1) {
-		return -1;
+		return false;
 	}
 
 	int radix = range_end - range_start + 1;
 	if (radix <= 0) {
-		return -1;
+		return false;
 	}
 
-	--number;
-
-	int num = number;
-	int last = at - 1;
-	while (num >= 0) {
-		++last;
-		num = num / radix - 1;
+	if (radix == ListIndexTables::LETTERS_RADIX && number <= ListIndexTables::LETTERS_COUNT) {
+		size_t length;
+		const char* letters = ListIndexTables::letters(number, length);
 
-		if (last == BUFFER_SIZE - 1) {
-			return -1;
+		for (size_t i = 0; i < length; ++i) {
+			text += range_start + (wchar_t)letters[i];
 		}
+
+		return true;
 	}
 
-	int i = last;
+	--number;
+
+	wchar_t chars[MAX_INDEX_LENGTH + 1];
+	size_t i = sizeof(chars) / sizeof(wchar_t);
+
 	while (number >= 0) {
-		buffer[i--] = range_start + (wchar_t)(number % radix);
+		if (i == 0) {
+			return false;
+		}
+
+		chars[--i] = range_start + (wchar_t)(number % radix);
 		number = number / radix - 1;
 	}
 
-	return last + 1;
+	text.append(chars + i, sizeof(chars) / sizeof(wchar_t) - i);
+	return true;
 }
 
 RomanNumbersIndexGenerator::RomanNumbersIndexGenerator(wchar_t left_bracket, wchar_t right_bracket, bool use_capitals)
@@ -170,9 +178,9 @@ RomanNumbersIndexGenerator::RomanNumbersIndexGenerator(wchar_t left_bracket, wch
 	this->use_capitals = use_capitals;
 }
 
-int RomanNumbersIndexGenerator::write_to_buffer(int at, int number) {
+bool RomanNumbersIndexGenerator::append_number(wstring& text, int number) const {
 	if (number < 1) {
-		return -1;
+		return false;
 	}
 
 	static const wchar_t* upper_case_digits[] =
@@ -182,19 +190,29 @@ int RomanNumbersIndexGenerator::write_to_buffer(int at, int number) {
 	static const int values[] = { 1, 4, 5, 9, 10, 40, 50, 90, 100, 400, 500, 900, 1000 };
 	static const int digits_count = sizeof(values) / sizeof(int);
 
+	if (number <= ListIndexTables::ROMAN_COUNT) {
+		size_t length;
+		const char* numeral = ListIndexTables::roman(number, length);
+
+		//The numerals are tabulated in capitals; ASCII lower case differs by a bit.
+		wchar_t case_bit = use_capitals ? 0 : 0x20;
+
+		for (size_t i = 0; i < length; ++i) {
+			text += (wchar_t)numeral[i] | case_bit;
+		}
+
+		return true;
+	}
+
 	const wchar_t** digits = (use_capitals) ? upper_case_digits : lower_case_digits;
 
 	int current_digit = digits_count - 1;
 	while (number) {
 		if (values[current_digit] <= number) {
-			const wchar_t* dp = digits[current_digit];
-
-			while(buffer[at] = *dp++) {
-				++at;
+			text += digits[current_digit];
 
-				if (at == BUFFER_SIZE) {
-					return -1;
-				}
+			if (text.length() > MAX_INDEX_LENGTH) {
+				return false;
 			}
 
 			number -= values[current_digit];
@@ -203,5 +221,5 @@ int RomanNumbersIndexGenerator::write_to_buffer(int at, int number) {
 		}
 	}
 
-	return at;
+	return true;
 }
@@ -0,0 +1,115 @@
+#include "../include/list_index_tables.hpp"
+
+using namespace std;
+using namespace stml;
+
+namespace {
+
+template<size_t COUNT, size_t LENGTH>
+struct PackedIndexes {
+	char chars[LENGTH];
+	unsigned short offsets[COUNT + 1];
+};
+
+constexpr const char* ROMAN_DIGITS[] =
+	{ "I", "IV", "V", "IX", "X", "XL", "L", "XC", "C", "CD", "D", "CM", "M" };
+constexpr int ROMAN_VALUES[] = { 1, 4, 5, 9, 10, 40, 50, 90, 100, 400, 500, 900, 1000 };
+constexpr int ROMAN_DIGITS_COUNT = sizeof(ROMAN_VALUES) / sizeof(int);
+
+/**
+ * Writes the Roman numeral of the number at the position
+ * (or only counts its length if 'chars' is NULL).
+ *
+ * @return the position right after the numeral.
+ */
+constexpr size_t write_roman(char* chars, size_t at, int number) {
+	int current_digit = ROMAN_DIGITS_COUNT - 1;
+	while (number) {
+		if (ROMAN_VALUES[current_digit] <= number) {
+			for (const char* dp = ROMAN_DIGITS[current_digit]; *dp; ++dp, ++at) {
+				if (chars) {
+					chars[at] = *dp;
+				}
+			}
+
+			number -= ROMAN_VALUES[current_digit];
+		} else {
+			--current_digit;
+		}
+	}
+
+	return at;
+}
+
+/**
+ * Writes the positions of the letters of the bijective numeral of the number
+ * at the position (or only counts its length if 'chars' is NULL).
+ *
+ * @return the position right after the numeral.
+ */
+constexpr size_t write_letters(char* chars, size_t at, int number) {
+	const int radix = ListIndexTables::LETTERS_RADIX;
+
+	--number;
+
+	size_t end = at;
+	for (int num = number; num >= 0; num = num / radix - 1) {
+		++end;
+	}
+
+	if (chars) {
+		for (size_t i = end; number >= 0; number = number / radix - 1) {
+			chars[--i] = (char)(number % radix);
+		}
+	}
+
+	return end;
+}
+
+typedef size_t (*IndexWriter)(char* chars, size_t at, int number);
+
+constexpr size_t packed_length(IndexWriter write, int count) {
+	size_t length = 0;
+	for (int n = 1; n <= count; ++n) {
+		length = write(NULL, length, n);
+	}
+
+	return length;
+}
+
+template<size_t COUNT, size_t LENGTH>
+constexpr PackedIndexes<COUNT, LENGTH> pack(IndexWriter write) {
+	static_assert(LENGTH <= 0xFFFF, "The offsets must fit unsigned short.");
+
+	PackedIndexes<COUNT, LENGTH> table = {};
+
+	size_t at = 0;
+	for (size_t n = 1; n <= COUNT; ++n) {
+		table.offsets[n - 1] = (unsigned short)at;
+		at = write(table.chars, at, n);
+	}
+	table.offsets[COUNT] = (unsigned short)at;
+
+	return table;
+}
+
+constexpr size_t ROMAN_LENGTH = packed_length(write_roman, ListIndexTables::ROMAN_COUNT);
+constexpr size_t LETTERS_LENGTH = packed_length(write_letters, ListIndexTables::LETTERS_COUNT);
+
+constexpr PackedIndexes<ListIndexTables::ROMAN_COUNT, ROMAN_LENGTH> ROMAN =
+	pack<ListIndexTables::ROMAN_COUNT, ROMAN_LENGTH>(write_roman);
+
+constexpr PackedIndexes<ListIndexTables::LETTERS_COUNT, LETTERS_LENGTH> LETTERS =
+	pack<ListIndexTables::LETTERS_COUNT, LETTERS_LENGTH>(write_letters);
+
+}
+
+const char* ListIndexTables::roman(int number, size_t& length) {
+	length = ROMAN.offsets[number] - ROMAN.offsets[number - 1];
+	return ROMAN.chars + ROMAN.offsets[number - 1];
+}
+
+const char* ListIndexTables::letters(int number, size_t& length) {
+	length = LETTERS.offsets[number] - LETTERS.offsets[number - 1];
+	return LETTERS.chars + LETTERS.offsets[number - 1];
+}
@@ -21,61 +21,251 @@ void MarkupBuilder::Char::put_char(wchar_t c, ostream& out) {
     out << out_buffer;
 }
 
-void MarkupBuilder::Char::write(ostream& out) const {
+void MarkupBuilder::Char::write(ostream& out, const EscapeTable* escapes) const {
+    write(out, NULL, escapes);
+}
+
+void MarkupBuilder::Char::write(ostream& out, const Char& over) const {
+    write(out, &over, NULL);
+}
+
+void MarkupBuilder::Char::write_decoration(ostream& out, const u32string& decorations, size_t at) {
+    decoration_id_t d = decorations[at];
+
+    if (d & INLINE) {
+        out.write((const char*)(decorations.data() + at + 1), d & INLINE_LENGTH);
+    } else {
+        out << DecorationTable::get(d & ~FOLLOWING);
+    }
+}
+
+void MarkupBuilder::Char::write_preceding(ostream& out, const u32string& decorations) {
+    //The preceding decorations are written in the reverse order, the last added first.
+    for (size_t end = decorations.size(); end > 0; ) {
+        size_t at = end - decoration_size(decorations[end - 1]);
+
+        if (!(decorations[at] & FOLLOWING)) {
+            write_decoration(out, decorations, at);
+        }
+
+        end = at;
+    }
+}
+
+void MarkupBuilder::Char::write_following(ostream& out, const u32string& decorations) {
+    for (size_t at = 0; at < decorations.size(); at += decoration_size(decorations[at])) {
+        if (decorations[at] & FOLLOWING) {
+            write_decoration(out, decorations, at);
+        }
+    }
+}
+
+void MarkupBuilder::Char::push_inline(const string& str, decoration_id_t following) {
+    if (str.length() > INLINE_LENGTH) {
+        throw length_error("decoration");
+    }
+
+    decoration_id_t mark = INLINE | following | (decoration_id_t)str.length();
+    size_t at = decorations.length();
+
+    decorations.resize(at + decoration_size(mark), 0);
+    decorations[at] = mark;
+    str.copy((char*)(&decorations[at + 1]), str.length());
+    decorations[decorations.length() - 1] = mark;
+}
+
+void MarkupBuilder::Char::write(ostream& out, const Char* over, const EscapeTable* escapes) const {
     if (itself) {
-        vector<char>::const_reverse_iterator prec;
-        for (prec = preceding.rbegin(); prec < preceding.rend(); ++prec) {
-            out << *prec;
+        if (over) {
+            write_preceding(out, over->decorations);
         }
+        write_preceding(out, decorations);
 
-        if (substituting.empty()) {
-        	if (itself != L'\0') {
-            	put_char(itself, out);
-        	}
+        decoration_id_t subst = (over && over->substituting != DecorationTable::NONE) ? over->substituting : substituting;
+
+        if (subst != DecorationTable::NONE) {
+            out << DecorationTable::get(subst);
+        }
+        else if (escapes && escapes->sequence(itself)) {
+            out << escapes->sequence(itself);
         }
         else {
-            char c = substituting.back();
-            if (c != '\0') {
-                out << c;
+            put_char(itself, out);
+        }
+
+        write_following(out, decorations);
+        if (over) {
+            write_following(out, over->decorations);
+        }
+    }
+}
+
+void MarkupBuilder::Char::merge(const Char& c) {
+    decorations += c.decorations;
+
+    if (c.substituting != DecorationTable::NONE) {
+        substituting = c.substituting;
+    }
+}
+
+void MarkupBuilder::Segment::write(ostream& out) const {
+    write(out, 0, chars.size());
+}
+
+void MarkupBuilder::Segment::write(ostream& out, size_t from, size_t length) const {
+    size_t end = from + length;
+    size_t i = from;
+
+    while (i < end) {
+        size_t plain = i;
+        while (plain < end && !chars[plain].decorated()) {
+            ++plain;
+        }
+
+        if (plain > i) {
+            write_text(out, text.data() + i, plain - i, NULL);
+            i = plain;
+        }
+
+        if (i < end) {
+            chars[i].write(out);
+            ++i;
+        }
+    }
+}
+
+void MarkupBuilder::write_text(ostream& out, const wchar_t* text, size_t length, const EscapeTable* escapes) {
+    static const size_t OUT_BUFFER_SIZE = 256;
+    char out_buffer[OUT_BUFFER_SIZE];
+    size_t in_buffer = 0;
+
+    size_t i = 0;
+    while (i < length) {
+        size_t special = escapes ? escapes->find(text, i, length) : length;
+
+        for (; i < special; ++i) {
+            if (in_buffer + MAX_UTF8_CHAR_LENGTH > OUT_BUFFER_SIZE) {
+                out.write(out_buffer, in_buffer);
+                in_buffer = 0;
             }
+
+            size_t bytes_written = write_utf8_char(text[i], out_buffer + in_buffer);
+            if (bytes_written == 0) {
+                out.write(out_buffer, in_buffer);
+                throw StmlException(StmlException::CHARACTER_CANNOT_BE_CONVERTED_TO_OUTPUT_FORMAT);
+            }
+            in_buffer += bytes_written;
         }
 
-        vector<char>::const_iterator foll;
-        for (foll = following.begin(); foll < following.end(); ++foll) {
-            out << *foll;
+        if (i < length) {
+            out.write(out_buffer, in_buffer);
+            in_buffer = 0;
+
+            out << escapes->sequence(text[i]);
+            ++i;
         }
     }
+
+    out.write(out_buffer, in_buffer);
 }
 
 MarkupBuilder::MarkupBuilder() {
-    text.reserve(DEFAULT_BUFFER_SIZE);
-    buffer.resize(DEFAULT_BUFFER_SIZE);
+    buffer = inline_buffer;
+    buffer_size = INLINE_BUFFER_SIZE;
     chars_in_buffer = 0;
+    escapes = NULL;
 }
 
 MarkupBuilder::MarkupBuilder(const MarkupBuilder& builder) {
+    buffer = inline_buffer;
+    buffer_size = INLINE_BUFFER_SIZE;
+    chars_in_buffer = 0;
+    escapes = NULL;
+
     *this = builder;
 }
 
+MarkupBuilder::~MarkupBuilder() {
+    release_buffer();
+}
+
 MarkupBuilder& MarkupBuilder::operator =(const MarkupBuilder& builder) {
+    if (this == &builder) {
+        return *this;
+    }
+
+    //The next char is copied along with the chars in the buffer.
+    if (buffer_size < builder.chars_in_buffer + 1) {
+        chars_in_buffer = 0;
+        grow_buffer(builder.buffer_size);
+    }
+
+    for (size_t i = 0; i <= builder.chars_in_buffer; ++i) {
+        buffer[i] = builder.buffer[i];
+    }
+
     text = builder.text;
-    buffer = builder.buffer;
     chars_in_buffer = builder.chars_in_buffer;
+    runs = builder.runs;
+    overlay = builder.overlay;
+    frozen = builder.frozen;
+    escapes = builder.escapes;
     return *this;
 }
 
 MarkupBuilder::Char& MarkupBuilder::operator [](size_t index) {
-    if (index >= chars_in_buffer) {
+    if (index >= text.length()) {
         throw out_of_range("index");
     }
 
-    return buffer[index];
+    return char_at(index);
+}
+
+MarkupBuilder::Char& MarkupBuilder::char_at(size_t index) {
+    //The char may be modified by the caller.
+    frozen.reset();
+
+    size_t lo = 0;
+    size_t hi = runs.size();
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (runs[mid].start <= index) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    const Run& run = runs[lo];
+    if (run.segment) {
+        return overlay[index];
+    }
+
+    return buffer[run.offset + index - run.start];
 }
 
 void MarkupBuilder::ensure_storage_for_next_char() {
-    size_t buf_size = buffer.size();
-    if (buf_size == chars_in_buffer + 1) {
-        buffer.resize(buf_size * 2);
+    if (buffer_size == chars_in_buffer + 1) {
+        grow_buffer(buffer_size * 2);
+    }
+}
+
+void MarkupBuilder::grow_buffer(size_t size) {
+    Char* new_buffer = new Char[size];
+
+    for (size_t i = 0; i <= chars_in_buffer; ++i) {
+        new_buffer[i].swap(buffer[i]);
+    }
+
+    release_buffer();
+
+    buffer = new_buffer;
+    buffer_size = size;
+}
+
+void MarkupBuilder::release_buffer() {
+    if (buffer != inline_buffer) {
+        delete[] buffer;
     }
 }
 
@@ -90,7 +280,19 @@ MarkupBuilder& MarkupBuilder::operator <<(const wchar_t* str) {
 
 MarkupBuilder& MarkupBuilder::operator <<(wchar_t c) {
     buffer[chars_in_buffer].set(c);
+
+    if (runs.empty() || runs.back().segment || runs.back().escapes != escapes) {
+        Run run;
+        run.start = text.length();
+        run.length = 0;
+        run.offset = chars_in_buffer;
+        run.escapes = escapes;
+        runs.push_back(run);
+    }
+    ++runs.back().length;
+
     text += c;
+    frozen.reset();
 
     ensure_storage_for_next_char();
 
@@ -101,20 +303,33 @@ MarkupBuilder& MarkupBuilder::operator <<(wchar_t c) {
 }
 
 MarkupBuilder& MarkupBuilder::operator <<(const MarkupBuilder& markup) {
+    return *this << markup.segment();
+}
 
-	wstring markup_text = markup.get_text();
-	size_t len = markup_text.length();
+MarkupBuilder& MarkupBuilder::operator <<(const SegmentPtr& segment) {
+    if (!segment || segment->text.empty()) {
+        return *this;
+    }
 
-	for (size_t i = 0; i < len; ++i) {
-		text += markup_text[i];
-		buffer[chars_in_buffer] = markup.buffer[i];
+    //Decorations put on the next char belong to the first spliced one.
+    Char& pending = buffer[chars_in_buffer];
+    if (pending.decorated()) {
+        overlay[text.length()] = pending;
+        pending.clear();
+    }
 
-		ensure_storage_for_next_char();
-		++chars_in_buffer;
-		buffer[chars_in_buffer].clear();
-	}
+    Run run;
+    run.start = text.length();
+    run.length = segment->text.length();
+    run.offset = 0;
+    run.segment = segment;
+    run.escapes = NULL;
+    runs.push_back(run);
 
-	return *this;
+    text += segment->text;
+    frozen.reset();
+
+    return *this;
 }
 
 void MarkupBuilder::substitute(size_t index, size_t length, const char* str) {
@@ -122,34 +337,34 @@ void MarkupBuilder::substitute(size_t index, size_t length, const char* str) {
         throw logic_error("length");
     }
 
-    if (index + length > chars_in_buffer) {
+    if (index + length > text.length()) {
         throw out_of_range("length");
     }
 
-    size_t len = char_traits<char>::length(str);
-    if (len == 0) {
+    if (*str == '\0') {
         return;
     }
 
+    //The rest of the substituted chars are written as nothing.
+    decoration_id_t nothing = DecorationTable::intern("");
     for (size_t i = 1; i < length; ++i) {
-        (*this)[index + i].substitute('\0');
+        (*this)[index + i].substitute(nothing);
     }
 
-    (*this)[index].substitute(str[0]);
-
-    for (size_t i = 1; i < len; ++i) {
-        (*this)[index].append(str[i]);
-    }
+    (*this)[index].substitute(DecorationTable::intern(str));
 }
 
 void MarkupBuilder::clear() {
     chars_in_buffer = 0;
     buffer[0].clear();
     text.clear();
+    runs.clear();
+    overlay.clear();
+    frozen.reset();
 }
 
 bool MarkupBuilder::empty() const {
-    return chars_in_buffer == 0;
+    return text.empty();
 }
 
 MarkupBuilder::Char& MarkupBuilder::first_char() {
@@ -157,7 +372,7 @@ MarkupBuilder::Char& MarkupBuilder::first_char() {
         throw out_of_range("");
     }
 
-    return buffer[0];
+    return char_at(0);
 }
 
 MarkupBuilder::Char& MarkupBuilder::last_char() {
@@ -165,7 +380,7 @@ MarkupBuilder::Char& MarkupBuilder::last_char() {
         throw out_of_range("");
     }
 
-    return buffer[chars_in_buffer - 1];
+    return char_at(text.length() - 1);
 }
 
 size_t MarkupBuilder::last_char_index() {
@@ -173,7 +388,7 @@ size_t MarkupBuilder::last_char_index() {
         throw out_of_range("");
     }
 
-    return chars_in_buffer - 1;
+    return text.length() - 1;
 }
 
 MarkupBuilder::Char& MarkupBuilder::next_char() {
@@ -184,9 +399,102 @@ const wstring& MarkupBuilder::get_text() const {
     return text;
 }
 
+MarkupBuilder::SegmentPtr MarkupBuilder::segment() const {
+    if (frozen) {
+        return frozen;
+    }
+
+    //A builder holding a single undecorated segment shares it as is.
+    if (runs.size() == 1 && runs[0].segment && overlay.empty()) {
+        frozen = runs[0].segment;
+        return frozen;
+    }
+
+    Segment* seg = new Segment();
+    frozen.reset(seg);
+
+    seg->text = text;
+    seg->chars.reserve(text.length());
+
+    for (vector<Run>::const_iterator run = runs.begin(); run != runs.end(); ++run) {
+        if (!run->segment) {
+            seg->chars.insert(
+                seg->chars.end(),
+                buffer + run->offset,
+                buffer + run->offset + run->length
+            );
+
+            //Segments are written as is, so the escapes become substitutions.
+            if (run->escapes) {
+                for (size_t i = seg->chars.size() - run->length; i < seg->chars.size(); ++i) {
+                    Char& c = seg->chars[i];
+                    decoration_id_t escape = run->escapes->id(seg->text[i]);
+
+                    if (escape != DecorationTable::NONE && !c.substituted()) {
+                        c.substitute(escape);
+                    }
+                }
+            }
+        } else {
+            for (size_t i = 0; i < run->length; ++i) {
+                seg->chars.push_back(run->segment->chars[run->offset + i]);
+
+                map<size_t, Char>::const_iterator over = overlay.find(run->start + i);
+                if (over != overlay.end()) {
+                    seg->chars.back().merge(over->second);
+                }
+            }
+        }
+    }
+
+    return frozen;
+}
+
 void MarkupBuilder::write(ostream& out) const {
-    for(size_t i = 0; i < chars_in_buffer; ++i) {
-        buffer[i].write(out);
+    map<size_t, Char>::const_iterator over = overlay.begin();
+
+    for (vector<Run>::const_iterator run = runs.begin(); run != runs.end(); ++run) {
+        if (!run->segment) {
+            size_t end = run->offset + run->length;
+            size_t i = run->offset;
+
+            while (i < end) {
+                //Undecorated chars are written by the whole stretch.
+                size_t plain = i;
+                while (plain < end && !buffer[plain].decorated()) {
+                    ++plain;
+                }
+
+                if (plain > i) {
+                    write_text(out, text.data() + run->start + (i - run->offset), plain - i, run->escapes);
+                    i = plain;
+                }
+
+                if (i < end) {
+                    buffer[i].write(out, run->escapes);
+                    ++i;
+                }
+            }
+        } else {
+            size_t i = 0;
+
+            while (i < run->length) {
+                if (over != overlay.end() && over->first == run->start + i) {
+                    run->segment->chars[run->offset + i].write(out, over->second);
+                    ++over;
+                    ++i;
+                    continue;
+                }
+
+                size_t stop = run->length;
+                if (over != overlay.end() && over->first < run->start + stop) {
+                    stop = over->first - run->start;
+                }
+
+                run->segment->write(out, run->offset + i, stop - i);
+                i = stop;
+            }
+        }
     }
 }
 
@@ -0,0 +1,69 @@
+#include "../include/output_index.hpp"
+#include "../include/utf8.hpp"
+
+using namespace std;
+using namespace stml;
+
+size_t OutputIndex::add(EntryKinds kind, int level, unsigned int source_line) {
+	Entry entry;
+	entry.kind = kind;
+	entry.level = level;
+	entry.source_line = source_line;
+	entry.offset = 0;
+	entry.length = 0;
+
+	entries.push_back(entry);
+
+	return entries.size() - 1;
+}
+
+void OutputIndex::clear() {
+	entries.clear();
+}
+
+void OutputIndex::write(ostream& out) const {
+	static const char kinds[] = { 'h', 's', 'b' };
+
+	for (vector<Entry>::const_iterator entry = entries.begin(); entry != entries.end(); ++entry) {
+		out << kinds[entry->kind] << '\t'
+			<< entry->level << '\t'
+			<< entry->source_line << '\t'
+			<< entry->offset << '\t'
+			<< entry->length << '\t';
+
+		//The fields are separated by tabs, so there must be none in the text.
+		for (wstring::const_iterator c = entry->text.begin(); c != entry->text.end(); ++c) {
+			write_utf8_char((*c == L'\t') ? L' ' : *c, out);
+		}
+
+		out << '\n';
+	}
+}
+
+CountingBuffer::CountingBuffer(streambuf* target) {
+	this->target = target;
+	count = 0;
+}
+
+CountingBuffer::int_type CountingBuffer::overflow(int_type c) {
+	if (traits_type::eq_int_type(c, traits_type::eof())) {
+		return traits_type::not_eof(c);
+	}
+
+	if (traits_type::eq_int_type(target->sputc(traits_type::to_char_type(c)), traits_type::eof())) {
+		return traits_type::eof();
+	}
+
+	++count;
+	return c;
+}
+
+streamsize CountingBuffer::xsputn(const char* s, streamsize n) {
+	streamsize written = target->sputn(s, n);
+	count += written;
+	return written;
+}
+
+int CountingBuffer::sync() {
+	return target->pubsync();
+}
@@ -13,6 +13,17 @@ using namespace stml;
 Parser::Parser(GeneratorTypes generator_type) {
     generator.reset(create_generator(generator_type));
 
+    create_states();
+}
+
+Parser::Parser(GeneratorTypes generator_type, const VariablesManager& prototype) {
+    generator.reset(create_generator(generator_type));
+    generator->set_variables(prototype);
+
+    create_states();
+}
+
+void Parser::create_states() {
     states[PARSER_STATE_START].reset(new StartParserState());
     states[PARSER_STATE_TAG].reset(new TagParserState());
     states[PARSER_STATE_INLINE_TAG].reset(new InlineTagParserState());
@@ -22,6 +33,18 @@ Parser::Parser(GeneratorTypes generator_type) {
     current_state = PARSER_STATE_START;
 }
 
+void Parser::set_decoration_threads(unsigned int threads) {
+    generator->set_decoration_threads(threads);
+}
+
+void Parser::set_output_index(OutputIndex* index) {
+    generator->set_output_index(index);
+}
+
+const VariablesManager& Parser::variables() const {
+    return generator->variables();
+}
+
 void Parser::parse(istream& in, ostream& out) {
     generator->set_output(&out);
     InputReader reader(&in);
@@ -40,6 +63,8 @@ void Parser::parse(istream& in, ostream& out) {
         while(reader.next_line()) {
             wchar_t c;
 
+            generator->set_source_line(line_no);
+
             current_state = PARSER_STATE_START;
             states[current_state]->init(start_state_data);
 
@@ -84,7 +109,17 @@ void Parser::parse(istream& in, ostream& out) {
     }
     catch (StmlException& ex) {
         ex.set_line_no(line_no);
+
+        //Write what has been generated before the error, as in the serial mode.
+        try {
+            generator->flush();
+        }
+        catch (...) {
+            //The error of the document is reported.
+        }
+
         throw;
     }
     generator->close_document();
+    generator->flush();
 }
@@ -422,7 +422,7 @@ ParserStates InlineTagParserState::process_char(wchar_t c, AbstractGeneratorPtr&
 	}
 
 	if (!name_parsed) {
-		bool is_tag_c;
+		bool is_tag_c = false;
 		if (is_space(c) || (is_tag_c = is_tag_close(c))) {
 			if (tag_name.empty()) {
 				throw StmlException(StmlException::NAMELESS_INLINE_TAG);
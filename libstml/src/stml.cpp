@@ -3,6 +3,9 @@
 #include "../include/input_reader.hpp"
 #include "../include/parser_state.hpp"
 #include "../include/parser.hpp"
+#include "../include/variables_manager.hpp"
+
+#include <sstream>
 
 using namespace stml;
 using namespace std;
@@ -12,6 +15,51 @@ void stml::parse(istream& in, ostream& out, GeneratorTypes generator_type) {
 	parser.parse(in, out);
 }
 
+void stml::parse(istream& in, ostream& out, GeneratorTypes generator_type, const VariablesManager& prototype) {
+	Parser parser(generator_type, prototype);
+	parser.parse(in, out);
+}
+
+void stml::parse(
+	istream& in,
+	ostream& out,
+	GeneratorTypes generator_type,
+	const VariablesManager* prototype,
+	unsigned int threads) {
+
+	unique_ptr<Parser> parser(prototype ? new Parser(generator_type, *prototype) : new Parser(generator_type));
+
+	parser->set_decoration_threads(threads);
+	parser->parse(in, out);
+}
+
+void stml::parse(
+	istream& in,
+	ostream& out,
+	GeneratorTypes generator_type,
+	const VariablesManager* prototype,
+	unsigned int threads,
+	OutputIndex& index) {
+
+	unique_ptr<Parser> parser(prototype ? new Parser(generator_type, *prototype) : new Parser(generator_type));
+
+	parser->set_decoration_threads(threads);
+	parser->set_output_index(&index);
+	parser->parse(in, out);
+}
+
+VariablesManager stml::make_prototype(istream& in, GeneratorTypes generator_type) {
+	Parser parser(generator_type);
+	ostringstream discarded;
+
+	parser.parse(in, discarded);
+
+	VariablesManager prototype = parser.variables();
+	prototype.freeze();
+
+	return prototype;
+}
+
 Alignments stml::parse_alignment(const wstring& alignment) {
 	if (alignment == L"al" || alignment == L"лв") {
 		return ALIGN_LEFT;
@@ -104,7 +152,8 @@ size_t stml::read_unit(const std::wstring& arg, size_t from, Units& unit) {
 }
 
 size_t stml::read_number(const wstring& arg, size_t from, int& number) {
-	wchar_t str[MAX_INT_SIZE];
+	//One more char for the terminating zero.
+	wchar_t str[MAX_INT_SIZE + 1];
 	size_t str_i = 0;
 	size_t arg_i = from;
 	size_t len = arg.length();
@@ -113,7 +162,7 @@ size_t stml::read_number(const wstring& arg, size_t from, int& number) {
 		return 0;
 	}
 
-	memset(str, 0, sizeof(wchar_t) * MAX_INT_SIZE);
+	memset(str, 0, sizeof(str));
 
 	while (str_i < MAX_INT_SIZE && arg_i < len && arg[arg_i] >= L'0' && arg[arg_i] <= L'9') {
 		str[str_i++] = arg[arg_i++];
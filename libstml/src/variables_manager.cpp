@@ -1,48 +1,219 @@
 #include "../include/stml.hpp"
 #include "../include/variables_manager.hpp"
 
+#include <cwchar>
+#include <mutex>
+
+using namespace std;
 using namespace stml;
 
-VariablesManager::VariablesManager() {
-	vars.resize(DEFAULT_BUFFER_SIZE);
+UnitSize VariablesManager::Variable::as_size() const {
+	//Sizes are parsed rarely, so one lock for all variables is enough.
+	static mutex lock;
+	lock_guard<mutex> guard(lock);
+
+	MarkupBuilder::SegmentPtr value = markup.segment();
+
+	if (value != size_value) {
+		const wstring& text = markup.get_text();
+
+		size.value = 0;
+		size.unit = SIZE_PX;
+
+		size_t number_len = read_number(text, 0, size.value);
+		if (number_len > 0 && number_len < text.length()) {
+			read_unit(text, number_len, size.unit);
+		}
+
+		size_value = value;
+	}
+
+	return size;
 }
 
-void VariablesManager::ensure_buffer_size_for_new_var() {
-    size_t buf_size = vars.size();
-    if (buf_size == vars_count + 1) {
-        vars.resize(buf_size * 2);
-    }
+shared_ptr<const ListFormat> VariablesManager::Variable::as_list_format() const {
+	//Formats are parsed rarely, so one lock for all variables is enough.
+	static mutex lock;
+	lock_guard<mutex> guard(lock);
+
+	MarkupBuilder::SegmentPtr value = markup.segment();
+
+	if (value != list_format_value || !list_format) {
+		list_format.reset();
+		list_format_value.reset();
+
+		list_format = ListFormat::parse(markup.get_text());
+		list_format_value = value;
+	}
+
+	return list_format;
 }
 
-VariablesManager::Variable& VariablesManager::operator[](const std::wstring name) {
-	for (std::vector<Variable>::iterator v = vars.begin();v != vars.end(); ++v) {
-		if (v->name == name) {
-			return *v;
-		}
+VariablesManager::VariablesManager() : storage(new Storage()) {
+}
+
+VariablesManager::VariablesManager(const Default* defaults, size_t count) : storage(new Storage()) {
+	storage->vars.reserve(count);
+
+	for (size_t i = 0; i < count; ++i) {
+		reset(defaults[i].name, defaults[i].value);
+	}
+
+	freeze();
+}
+
+size_t VariablesManager::hash(const wchar_t* name, size_t length) {
+	//FNV-1a.
+	size_t h = 2166136261u;
+	for (size_t i = 0; i < length; ++i) {
+		h = (h ^ (size_t)name[i]) * 16777619u;
 	}
 
-	throw std::out_of_range("name");
+	return h;
 }
 
-var_id_t VariablesManager::get_by_name(const wchar_t* name) {
-	for (var_id_t i = 0; i < vars_count; ++i) {
-		if (vars[i].name == name) {
-			return i;
+size_t VariablesManager::find_slot(const wchar_t* name, size_t length) const {
+	const vector<var_id_t>& index = storage->index;
+	size_t mask = index.size() - 1;
+	size_t slot = hash(name, length) & mask;
+
+	for (;;) {
+		var_id_t id = index[slot];
+
+		if (id == UNKNOWN_VAR) {
+			return slot;
 		}
+
+		const wstring& var_name = storage->vars[id]->name;
+		if (var_name.length() == length && wmemcmp(var_name.data(), name, length) == 0) {
+			return slot;
+		}
+
+		slot = (slot + 1) & mask;
+	}
+}
+
+void VariablesManager::index_last_var() {
+	vector<VariablePtr>& vars = storage->vars;
+	vector<var_id_t>& index = storage->index;
+
+	if (vars.size() * 2 > index.size()) {
+		size_t new_size = index.empty() ? DEFAULT_INDEX_SIZE : index.size() * 2;
+
+		index.assign(new_size, UNKNOWN_VAR);
+
+		for (var_id_t id = 0; id + 1 < vars.size(); ++id) {
+			const wstring& name = vars[id]->name;
+			index[find_slot(name.data(), name.length())] = id;
+		}
+	}
+
+	const wstring& name = vars.back()->name;
+	index[find_slot(name.data(), name.length())] = vars.size() - 1;
+}
+
+VariablesManager::Storage& VariablesManager::own_storage() {
+	if (storage.use_count() > 1) {
+		//The variables themselves stay shared until they are changed.
+		storage.reset(new Storage(*storage));
 	}
 
-	return UNKNOWN_VAR;
+	return *storage;
+}
+
+VariablesManager::Variable& VariablesManager::own_var(var_id_t id) {
+	VariablePtr& var = own_storage().vars[id];
+
+	if (var.use_count() > 1) {
+		var.reset(new Variable(*var));
+	}
+
+	return *var;
+}
+
+var_id_t VariablesManager::find(const wchar_t* name, size_t length) const {
+	if (storage->index.empty()) {
+		return UNKNOWN_VAR;
+	}
+
+	return storage->index[find_slot(name, length)];
+}
+
+VariablesManager::Variable& VariablesManager::operator[](const std::wstring& name) {
+	var_id_t id = find(name.data(), name.length());
+
+	if (id == UNKNOWN_VAR) {
+		throw std::out_of_range("name");
+	}
+
+	return own_var(id);
+}
+
+VariablesManager::Variable& VariablesManager::operator[](const wchar_t* name) {
+	var_id_t id = get_by_name(name);
+
+	if (id == UNKNOWN_VAR) {
+		throw std::out_of_range("name");
+	}
+
+	return own_var(id);
+}
+
+const VariablesManager::Variable& VariablesManager::get(const std::wstring& name) const {
+	var_id_t id = find(name.data(), name.length());
+
+	if (id == UNKNOWN_VAR) {
+		throw std::out_of_range("name");
+	}
+
+	return get(id);
+}
+
+const VariablesManager::Variable& VariablesManager::get(const wchar_t* name) const {
+	var_id_t id = get_by_name(name);
+
+	if (id == UNKNOWN_VAR) {
+		throw std::out_of_range("name");
+	}
+
+	return get(id);
+}
+
+var_id_t VariablesManager::get_by_name(const wchar_t* name) const {
+	return find(name, wcslen(name));
 }
 
 var_id_t VariablesManager::reset(const wchar_t* name, const wchar_t* default_value) {
-	ensure_buffer_size_for_new_var();
+	var_id_t id = get_by_name(name);
+	bool created = id == UNKNOWN_VAR;
+	Storage& own = own_storage();
 
-	var_id_t id = vars_count++;
-	Variable& new_var = vars[id];
+	if (created) {
+		id = own.vars.size();
+		own.vars.push_back(VariablePtr());
+	} else if (own.vars[id].use_count() == 1) {
+		own.vars[id]->markup.clear();
+		own.vars[id]->markup << default_value;
+		return id;
+	}
 
-	new_var.name = name;
-	new_var.markup.clear();
-	new_var.markup << default_value;
+	//New variables and the ones shared with other managers
+	//are created from scratch rather than copied.
+	VariablePtr var(new Variable());
+	var->name = name;
+	var->markup << default_value;
+	own.vars[id] = var;
+
+	if (created) {
+		index_last_var();
+	}
 
 	return id;
 }
+
+void VariablesManager::freeze() const {
+	for (vector<VariablePtr>::const_iterator var = storage->vars.begin(); var != storage->vars.end(); ++var) {
+		(*var)->as_utf8();
+		(*var)->as_alignment();
+	}
+}
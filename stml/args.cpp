@@ -1,5 +1,7 @@
 #include <cstring>
+#include <cstdlib>
 #include <unistd.h>
+#include <getopt.h>
 #include <iostream>
 
 #include "args.hpp"
@@ -7,14 +9,26 @@
 using namespace std;
 using namespace stml;
 
+static const int OPT_VARS = 256;
+static const int OPT_INDEX = 257;
+
 Args::Args(int argc, char *argv[]) {
-    char c;
+    static const option long_options[] = {
+        { "vars", required_argument, NULL, OPT_VARS },
+        { "index", no_argument, NULL, OPT_INDEX },
+        { NULL, 0, NULL, 0 }
+    };
+
+    int c;
 
     error = false;
+    vars_file = NULL;
+    threads = 0;
+    index = false;
 
     bool generator_specified = false;
 
-    while ((c = getopt(argc, argv, "g:")) != -1) {
+    while ((c = getopt_long(argc, argv, "g:D:j:", long_options, NULL)) != -1) {
         switch (c) {
         case 'g':
             if (strcmp(optarg, "html") == 0) {
@@ -30,6 +44,39 @@ Args::Args(int argc, char *argv[]) {
                 error = true;
             }
             break;
+        case 'D': {
+            const char* eq = strchr(optarg, '=');
+
+            if (eq == NULL || eq == optarg) {
+                cerr << "Invalid variable definition '" << optarg << "'." << endl;
+                error = true;
+            }
+            else {
+                //The value is STML, as if it were set in the document.
+                definitions.append("<$").append(optarg, eq - optarg).append(">");
+                definitions.append(eq + 1).append("\n");
+            }
+            break;
+        }
+        case 'j': {
+            char* end;
+            long n = strtol(optarg, &end, 10);
+
+            if (*end != '\0' || n < 0) {
+                cerr << "Invalid number of threads '" << optarg << "'." << endl;
+                error = true;
+            }
+            else {
+                threads = (unsigned int)n;
+            }
+            break;
+        }
+        case OPT_VARS:
+            vars_file = optarg;
+            break;
+        case OPT_INDEX:
+            index = true;
+            break;
         case '?':
         default:
             cerr << "Unexpected option '" << optopt << "'." << endl;
@@ -37,6 +84,15 @@ Args::Args(int argc, char *argv[]) {
         }
     }
 
+    for (int i = optind; i < argc; ++i) {
+        input_files.push_back(argv[i]);
+    }
+
+    if (index && input_files.empty()) {
+        cerr << "The output of the standard input cannot be indexed." << endl;
+        error = true;
+    }
+
     if (!generator_specified) {
         cerr << "Generator type has not been specified." << endl;
         error = true;
@@ -1,14 +1,45 @@
-
 #ifndef ARGS_PARSER_HPP_
 #define ARGS_PARSER_HPP_
 
 #include <stml.hpp>
 
+#include <string>
+#include <vector>
+
 class Args {
 public:
     Args(int argc, char *argv[]);
 
     stml::GeneratorTypes generator_type;
+
+    /**
+     * Variables set by -D name=value, as STML.
+     */
+    std::string definitions;
+
+    /**
+     * STML file with variables (--vars); NULL if not specified.
+     */
+    const char* vars_file;
+
+    /**
+     * Documents to be generated. The standard input
+     * is read if no documents specified.
+     */
+    std::vector<const char*> input_files;
+
+    /**
+     * Number of the threads decorating the lines (-j); 0 if the lines
+     * are decorated by the parsing thread.
+     */
+    unsigned int threads;
+
+    /**
+     * Whether the positions of the headers, sections and top-level blocks
+     * in the output are written to the .idx file next to it (--index).
+     */
+    bool index;
+
     bool error;
 };
 
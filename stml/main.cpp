@@ -1,5 +1,11 @@
 #include <stml.hpp>
 #include <stml_exception.hpp>
+#include <variables_manager.hpp>
+#include <output_index.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <memory>
 
 #include "error_message.hpp"
 #include "args.hpp"
@@ -7,6 +13,58 @@
 using namespace std;
 using namespace stml;
 
+/**
+ * Parses the variables file and the -D definitions once, so that every
+ * document starts with them. The prototype stays empty if there are none.
+ *
+ * @return false if the variables file cannot be read.
+ */
+static bool load_variables(const Args& args, unique_ptr<VariablesManager>& prototype) {
+	if (args.vars_file == NULL && args.definitions.empty()) {
+		return true;
+	}
+
+	stringstream settings;
+
+	if (args.vars_file != NULL) {
+		ifstream vars_in(args.vars_file, ios::in | ios::binary);
+
+		if (!vars_in) {
+			cerr << "Cannot open '" << args.vars_file << "'." << endl;
+			return false;
+		}
+
+		settings << vars_in.rdbuf() << endl;
+	}
+
+	settings << args.definitions;
+
+	prototype.reset(new VariablesManager(make_prototype(settings, args.generator_type)));
+	return true;
+}
+
+static string output_file_name(const char* input_file, GeneratorTypes generator_type) {
+	string name(input_file);
+	const char* extension = (generator_type == GENERATOR_TEX) ? ".tex" : ".html";
+
+	size_t dot = name.rfind('.');
+	if (dot != string::npos && name.substr(dot) == ".stml") {
+		name.erase(dot);
+	}
+
+	return name + extension;
+}
+
+static void generate(istream& in, ostream& out, const Args& args, const VariablesManager* prototype) {
+	if (args.threads > 0) {
+		parse(in, out, args.generator_type, prototype, args.threads);
+	} else if (prototype) {
+		parse(in, out, args.generator_type, *prototype);
+	} else {
+		parse(in, out, args.generator_type);
+	}
+}
+
 int main(int argc, char *argv[]) {
 
     Args args(argc, argv);
@@ -16,8 +74,43 @@ int main(int argc, char *argv[]) {
     }
 
 	int return_code = 0;
+	const char* file = NULL;
+
 	try {
-		parse(cin, cout, args.generator_type);
+		unique_ptr<VariablesManager> prototype;
+
+		file = args.vars_file;
+		if (!load_variables(args, prototype)) {
+			return -1;
+		}
+		file = NULL;
+
+		if (args.input_files.empty()) {
+			generate(cin, cout, args, prototype.get());
+		}
+
+		for (size_t i = 0; i < args.input_files.size(); ++i) {
+			file = args.input_files[i];
+
+			ifstream in(file, ios::in | ios::binary);
+			if (!in) {
+				cerr << "Cannot open '" << file << "'." << endl;
+				return -1;
+			}
+
+			string output_name = output_file_name(file, args.generator_type);
+			ofstream out(output_name.c_str(), ios::out | ios::binary);
+
+			if (args.index) {
+				OutputIndex index;
+				parse(in, out, args.generator_type, prototype.get(), args.threads, index);
+
+				ofstream index_out((output_name + ".idx").c_str(), ios::out | ios::binary);
+				index.write(index_out);
+			} else {
+				generate(in, out, args, prototype.get());
+			}
+		}
 	}
 	catch (const StmlException& ex) {
 		cerr << get_error_message(ex.get_code());
@@ -27,6 +120,10 @@ int main(int argc, char *argv[]) {
 		    cerr << " at line " << line_no;
 		}
 
+		if (file) {
+			cerr << " in '" << file << "'";
+		}
+
 		cerr << ".";
 
 		return_code = (int)ex.get_code();
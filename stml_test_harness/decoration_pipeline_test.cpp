@@ -0,0 +1,35 @@
+#include <cassert>
+#include "decoration_pipeline_test.hpp"
+#include "../libstml/include/stml.hpp"
+#include <sstream>
+#include <string>
+
+using namespace std;
+using namespace stml;
+
+void decoration_pipeline_test() {
+    stringstream doc;
+
+    doc << "<doc>\n";
+    for (int i = 0; i < 100; ++i) {
+        doc << "\"Предсказатель\" - кто-нибудь, двадцать \"якобы\" необъяснимый " << i << "\n\n";
+    }
+    doc << "<pre>\n\"не\" - переносить\n<.>\n";
+
+    GeneratorTypes types[] = { GENERATOR_HTML, GENERATOR_TEX };
+
+    for (int t = 0; t < 2; ++t) {
+        stringstream in(doc.str());
+        stringstream serial;
+        parse(in, serial, types[t]);
+
+        //The output doesn't depend on the number of threads.
+        for (unsigned int threads = 1; threads <= 3; ++threads) {
+            stringstream pipelined_in(doc.str());
+            stringstream pipelined;
+            parse(pipelined_in, pipelined, types[t], NULL, threads);
+
+            assert(pipelined.str() == serial.str());
+        }
+    }
+}
@@ -0,0 +1,6 @@
+#ifndef DECORATION_PIPELINE_TEST_HPP_
+#define DECORATION_PIPELINE_TEST_HPP_
+
+void decoration_pipeline_test();
+
+#endif /* DECORATION_PIPELINE_TEST_HPP_ */
@@ -0,0 +1,137 @@
+#include <cassert>
+#include "html_generator_test.hpp"
+#include "../libstml/include/stml.hpp"
+#include "../libstml/include/output_index.hpp"
+#include <sstream>
+#include <string>
+
+using namespace std;
+using namespace stml;
+
+static string generate_html(const string& doc) {
+    stringstream in(doc);
+    stringstream out;
+    parse(in, out, GENERATOR_HTML);
+    return out.str();
+}
+
+void html_style_classes() {
+    string body = "<$html_p_class>p\n<$html_p_style>color:red;\nText.\n";
+    string doc = "<doc>\n<$html_style_classes>y\n<$html_p_style>color:blue;\n<>\nText.\n" + body;
+    string html = generate_html(doc);
+
+    //The styles known to the header are declared as classes.
+    assert(html.find(".stml_s0{color:blue;}") != string::npos);
+    assert(html.find("<p class='stml_s0 stml_s") != string::npos);
+
+    //The style changed after the header stays inline.
+    assert(html.find("<p class='p' style='color:red;text-align:justify;'") != string::npos);
+
+    string inline_html = generate_html("<doc>\n<$html_p_style>color:blue;\n<>\nText.\n" + body);
+    assert(inline_html.find("stml_s") == string::npos);
+    assert(inline_html.find("<p style='color:blue;text-align:justify;'") != string::npos);
+}
+
+void html_no_entities() {
+    string text = "\"Предсказатель\" - кто-нибудь.\n";
+    string html = generate_html("<doc>\n<$html_no_entities>y\n<>\n" + text);
+
+    assert(html.find("&") == string::npos);
+    assert(html.find("\xC2\xAB" "Пред\xC2\xAD") != string::npos);
+    assert(html.find("\xC2\xBB \xE2\x80\x94 ") != string::npos);
+
+    string entities_html = generate_html("<doc>\n<>\n" + text);
+    assert(entities_html.find("&laquo;Пред&shy;") != string::npos);
+}
+
+void html_browser_hyphenation() {
+    string html = generate_html("<doc>\n<$html_browser_hyphenation>y\n<>\n\"Предсказатель\" - кто-нибудь.\n");
+
+    assert(html.find("<html lang=\"ru\">") != string::npos);
+    assert(html.find("hyphens:auto;") != string::npos);
+    assert(html.find("&shy;") == string::npos);
+
+    //The quotes and the dashes are still substituted.
+    assert(html.find("&laquo;Предсказатель&raquo; &mdash; кто-нибудь.") != string::npos);
+}
+
+void html_minify() {
+    string doc =
+        "<doc>\n<$html_minify>y\n<$html_body_class>b\n<$html_p_class>p q\n<>\n"
+        "<p>\nLine 1.\nLine 2.\n<>\n<pre>\nPre 1.\nPre 2.\n<>\n";
+    string html = generate_html(doc);
+
+    assert(html.find("<meta charset=utf-8>") != string::npos);
+    assert(html.find("<body class=b>") != string::npos);
+    assert(html.find("<p class='p q' style=text-align:justify;>Line 1.<br>Line 2.</p><pre>Pre 1.\nPre 2.</pre>") != string::npos);
+    assert(html.find("  ") == string::npos);
+
+    //The lines of the plain text stay separated.
+    string plain_html = generate_html(
+        "<doc>\n<$html_minify>y\n<$html_no_default_paragraphs>y\n<>\nfirst line\nsecond line\n");
+    assert(plain_html.find("<body>first line\nsecond line\n</body>") != string::npos);
+}
+
+void html_output_index() {
+    string doc = "<doc>\n<>\n<h 1>Chapter\n<s>\n<h 2>\nPart\none\n<>\nText.\n<>\n<hr>\nEnd.\n";
+
+    //The offsets are the same when the lines are decorated by the threads.
+    for (unsigned int threads = 0; threads <= 2; threads += 2) {
+        stringstream in(doc);
+        stringstream out;
+        OutputIndex index;
+        parse(in, out, GENERATOR_HTML, NULL, threads, index);
+
+        string html = out.str();
+
+        assert(index.size() == 5);
+
+        assert(index[0].kind == OutputIndex::INDEX_ENTRY_HEADER);
+        assert(index[0].level == 1 && index[0].source_line == 3 && index[0].text == L"Chapter");
+        assert(html.substr(index[0].offset, index[0].length) == "<h1 >Chapter</h1>\n");
+
+        assert(index[1].kind == OutputIndex::INDEX_ENTRY_SECTION && index[1].source_line == 4);
+        assert(html.substr(index[1].offset, index[1].length) ==
+            "<div ><h2 >Part<br/>one</h2>\n<p  style='text-align:justify;' >Text.</p>\n</div>\n");
+
+        //The paragraph of the section is not a top-level block.
+        assert(index[2].kind == OutputIndex::INDEX_ENTRY_HEADER && index[2].text == L"Part one");
+        assert(html.substr(index[2].offset, index[2].length) == "<h2 >Part<br/>one</h2>\n");
+
+        assert(index[3].kind == OutputIndex::INDEX_ENTRY_BLOCK && index[3].source_line == 11);
+        assert(html.substr(index[3].offset, index[3].length) == "<hr />");
+
+        assert(index[4].kind == OutputIndex::INDEX_ENTRY_BLOCK && index[4].source_line == 12);
+        assert(html.substr(index[4].offset, index[4].length) == "<p  style='text-align:justify;' >End.</p>\n");
+    }
+}
+
+void html_toc() {
+    string doc = "<doc>\n<$html_toc>y\n<>\n<h 1>One & two\n<h 2>\nPart\nthree\n<>\nText.\n";
+    string html = generate_html(doc);
+
+    assert(html.find("#stml_toc ul{") != string::npos);
+    assert(html.find("<h1 id='stml_h1'>One &amp; two</h1>") != string::npos);
+    assert(html.find("<h2 id='stml_h2'>Part<br/>three</h2>") != string::npos);
+
+    //The contents are written before the text of the document.
+    assert(html.find(
+        "<body ><nav id='stml_toc'><ul><li class='stml_toc_h1'><a href='#stml_h1'>One &amp; two</a></li>"
+        "<li class='stml_toc_h2'><a href='#stml_h2'>Part three</a></li></ul></nav>\n<h1 ") != string::npos);
+
+    //The offsets of the held text are shifted by the contents.
+    for (unsigned int threads = 0; threads <= 2; threads += 2) {
+        stringstream in(doc);
+        stringstream out;
+        OutputIndex index;
+        parse(in, out, GENERATOR_HTML, NULL, threads, index);
+
+        assert(out.str() == html);
+        assert(index.size() == 3);
+        assert(html.substr(index[1].offset, index[1].length) == "<h2 id='stml_h2'>Part<br/>three</h2>\n");
+    }
+
+    string plain_html = generate_html("<doc>\n<>\n<h 1>One\n");
+    assert(plain_html.find("stml_toc") == string::npos);
+    assert(plain_html.find("<h1 >One</h1>") != string::npos);
+}
@@ -0,0 +1,11 @@
+#ifndef HTML_GENERATOR_TEST_HPP_
+#define HTML_GENERATOR_TEST_HPP_
+
+void html_style_classes();
+void html_no_entities();
+void html_browser_hyphenation();
+void html_minify();
+void html_output_index();
+void html_toc();
+
+#endif /* HTML_GENERATOR_TEST_HPP_ */
@@ -12,7 +12,7 @@ using namespace stml;
 void list_format() {
 	ListFormat fmt;
 	ListItemsCounter cnt;
-	wstring index;
+	ListIndex indexes[6];
 
 	fmt.set(L"#./.#./#)/(I)/i./(a-z)");
 
@@ -20,8 +20,8 @@ void list_format() {
 		for (int j = i; j < 6; ++j) {
 			cnt.increment(i + 1);
 
-			index = fmt.generator(i + 1)->generate_index(cnt.current_item_path());
-			wcout << index << endl;
+			fmt.generator(i + 1)->update_index(cnt.current_item_path(), indexes[i]);
+			wcout << indexes[i].text << endl;
 		}
 	}
 }
@@ -1,5 +1,7 @@
 #include "list_index_generators_test.hpp"
 #include "../libstml/include/list_index_generators.hpp"
+#include "../libstml/include/stml_exception.hpp"
+#include "../libstml/include/list_index_tables.hpp"
 
 #include "roman_indexes.hpp"
 
@@ -12,60 +14,72 @@
 using namespace std;
 using namespace stml;
 
+/**
+ * Updates the index for the item and returns its text.
+ */
+static const wstring& next_index(const AbstractListIndexGenerator& generator, const vector<int>& item_path, ListIndex& index) {
+	generator.update_index(item_path, index);
+	return index.text;
+}
+
 void multi_level_list_index_generator() {
 	auto_ptr<MultiLevelNumericListIndexGenerator> generator(new MultiLevelNumericListIndexGenerator());
 	vector<int> item_path;
+	ListIndex list_index;
 	wstring index;
 
 	item_path.push_back(1);
-	index = generator->generate_index(item_path);
+	index = next_index(*generator, item_path, list_index);
 	assert(index == L"1.");
 
 	item_path.push_back(2);
-	index = generator->generate_index(item_path);
+	index = next_index(*generator, item_path, list_index);
 	assert(index == L"1.2.");
 
 	item_path.push_back(3);
-	index = generator->generate_index(item_path);
+	index = next_index(*generator, item_path, list_index);
 	assert(index == L"1.2.3.");
 }
 
 void single_level_numeric_list_index_generator() {
 	auto_ptr<SingleLevelListIndexGenerator> generator(new SingleLevelListIndexGenerator(L'(', L')'));
 	vector<int> item_path;
+	ListIndex list_index;
 	wstring index;
 
 	item_path.push_back(1);
-	index = generator->generate_index(item_path);
+	index = next_index(*generator, item_path, list_index);
 	assert(index == L"(1)");
 
 	item_path.push_back(2);
-	index = generator->generate_index(item_path);
+	index = next_index(*generator, item_path, list_index);
 	assert(index == L"(2)");
 
 	item_path.push_back(3);
-	index = generator->generate_index(item_path);
+	index = next_index(*generator, item_path, list_index);
 	assert(index == L"(3)");
 
 	generator.reset(new SingleLevelListIndexGenerator(L'\0', L'.'));
+	list_index.clear();
 	item_path.clear();
 	item_path.push_back(1);
 
-	index = generator->generate_index(item_path);
+	index = next_index(*generator, item_path, list_index);
 	assert(index == L"1.");
 
 	item_path.push_back(2);
-	index = generator->generate_index(item_path);
+	index = next_index(*generator, item_path, list_index);
 	assert(index == L"2.");
 
 	item_path.push_back(3);
-	index = generator->generate_index(item_path);
+	index = next_index(*generator, item_path, list_index);
 	assert(index == L"3.");
 }
 
 void char_range_list_index_generator() {
 	auto_ptr<CharRangeIndexGenerator> generator(new CharRangeIndexGenerator(L'(', L')', 'A', 'C'));
 	vector<int> item_path;
+	ListIndex list_index;
 	wstring index;
 
 	static const wchar_t* indexes[] =
@@ -77,7 +91,7 @@ void char_range_list_index_generator() {
 
 	for (int i = 0; i < sizeof(indexes) / sizeof(wchar_t*); ++i) {
 		item_path.push_back(i + 1);
-		index = generator->generate_index(item_path);
+		index = next_index(*generator, item_path, list_index);
 		assert(index == indexes[i]);
 	}
 }
@@ -85,6 +99,7 @@ void char_range_list_index_generator() {
 void roman_list_index_generator() {
 	auto_ptr<RomanNumbersIndexGenerator> generator(new RomanNumbersIndexGenerator(L'(', L')', true));
 	vector<int> item_path;
+	ListIndex list_index;
 	wstring index;
 
 	item_path.push_back(0);
@@ -93,7 +108,7 @@ void roman_list_index_generator() {
 
 	for (int i = 1; i < 3000; ++i) {
 		item_path[0] = i;
-		index = generator->generate_index(item_path);
+		index = next_index(*generator, item_path, list_index);
 
 		assert(index == roman_indexes[i - 1]);
 
@@ -106,3 +121,86 @@ void roman_list_index_generator() {
 
 	//wcout << "};";
 }
+
+void incremental_list_index_update() {
+	MultiLevelNumericListIndexGenerator generator;
+	ListIndex index;
+	vector<int> item_path;
+
+	item_path.push_back(12);
+	item_path.push_back(3);
+	generator.update_index(item_path, index);
+	assert(index.text == L"12.3.");
+
+	item_path[1] = 4;
+	item_path.push_back(1);
+	generator.update_index(item_path, index);
+	assert(index.text == L"12.4.1.");
+	assert(index.ends.size() == 3 && index.ends[0] == 3 && index.ends[1] == 5);
+
+	item_path.pop_back();
+	item_path.pop_back();
+	item_path[0] = 13;
+	generator.update_index(item_path, index);
+	assert(index.text == L"13.");
+
+	//The index can't be longer than the generators allow.
+	item_path.assign(30, 1);
+	bool overflow = false;
+	try {
+		generator.update_index(item_path, index);
+	} catch (StmlException&) {
+		overflow = true;
+	}
+	assert(overflow && index.text.empty());
+
+	RomanNumbersIndexGenerator roman(L'\0', L'.', false);
+	ListIndex roman_index;
+
+	item_path.assign(2, 4);
+	roman.update_index(item_path, roman_index);
+	assert(roman_index.text == L"iv.");
+}
+
+void list_index_tables() {
+	//The tabulated numerals are the same as the computed ones.
+	for (int i = 1; i < 3000; ++i) {
+		size_t length;
+		const char* numeral = ListIndexTables::roman(i, length);
+
+		wstring expected(roman_indexes[i - 1]);
+		assert(wstring(numeral, numeral + length) == expected.substr(1, expected.length() - 2));
+	}
+
+	RomanNumbersIndexGenerator roman(L'\0', L'\0', false);
+	ListIndex roman_index;
+	vector<int> item_path(1);
+
+	item_path[0] = ListIndexTables::ROMAN_COUNT;
+
+	assert(next_index(roman, item_path, roman_index) == L"mmmcmxcix");
+
+	item_path[0] = ListIndexTables::ROMAN_COUNT + 1;
+	assert(next_index(roman, item_path, roman_index) == L"mmmm");
+
+	//Letter indexes beyond the table are computed.
+	CharRangeIndexGenerator letters(L'\0', L'\0', L'a', L'z');
+	ListIndex letters_index;
+	wstring expected(L"a");
+
+	for (int i = 1; i <= ListIndexTables::LETTERS_COUNT + 30; ++i) {
+		item_path[0] = i;
+		assert(next_index(letters, item_path, letters_index) == expected);
+
+		size_t digit = expected.length();
+		while (digit > 0 && expected[digit - 1] == L'z') {
+			expected[--digit] = L'a';
+		}
+
+		if (digit > 0) {
+			++expected[digit - 1];
+		} else {
+			expected.insert(expected.begin(), L'a');
+		}
+	}
+}
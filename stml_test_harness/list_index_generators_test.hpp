@@ -5,5 +5,7 @@ void multi_level_list_index_generator();
 void single_level_numeric_list_index_generator();
 void char_range_list_index_generator();
 void roman_list_index_generator();
+void incremental_list_index_update();
+void list_index_tables();
 
 #endif /* LIST_INDEX_GENERATOR_HPP_ */
@@ -3,17 +3,38 @@
 #include "list_items_counter_test.hpp"
 #include "list_index_generators_test.hpp"
 #include "list_format_test.hpp"
+#include "variables_manager_test.hpp"
+#include "decoration_pipeline_test.hpp"
+#include "html_generator_test.hpp"
 
 int main() {
     markup_builder_test();
     markup_builder_merge();
+    markup_builder_splice();
+    markup_builder_growth();
+    markup_builder_decorations();
+    markup_builder_escapes();
     ru_language_test();
+    ru_language_decorate();
     list_items_counter_test();
     multi_level_list_index_generator();
     single_level_numeric_list_index_generator();
     char_range_list_index_generator();
     roman_list_index_generator();
+    incremental_list_index_update();
+    list_index_tables();
     list_format();
+    variables_manager_utf8();
+    variables_manager_lookup();
+    variables_manager_prototype();
+    variables_manager_views();
+    decoration_pipeline_test();
+    html_style_classes();
+    html_no_entities();
+    html_browser_hyphenation();
+    html_minify();
+    html_output_index();
+    html_toc();
 
     return 0;
 }
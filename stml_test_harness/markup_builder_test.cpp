@@ -53,3 +53,150 @@ void markup_builder_merge() {
 
 	assert(s == "abcdef");
 }
+
+void markup_builder_splice() {
+	MarkupBuilder var, line;
+
+	var << L"xyz";
+	var.first_char().prepend("<b>");
+	var.last_char().append("</b>");
+
+	line << L"a";
+	line.next_char().prepend("<i>");
+	line << var << var << L'b';
+
+	//Decorations of the line must not leak into the variable.
+	line[2].substitute('Y');
+	line[4].append("|");
+	line.substitute(5, 1, "&z;");
+
+	assert(line.get_text() == L"axyzxyzb");
+
+	stringstream out;
+	line.write(out);
+	assert(out.str() == "a<i><b>xYz</b><b>x|&z;z</b>b");
+
+	stringstream var_out;
+	var.write(var_out);
+	assert(var_out.str() == "<b>xyz</b>");
+
+	//Frozen content is written the same way as the builder itself.
+	stringstream seg_out;
+	line.segment()->write(seg_out);
+	assert(seg_out.str() == out.str());
+}
+
+void markup_builder_growth() {
+	MarkupBuilder bld;
+
+	bld << L"abc";
+	bld.first_char().prepend("<p>");
+
+	//Copying a builder which chars still fit the inline buffer.
+	MarkupBuilder small(bld);
+
+	bld << L"defghijklmnopqrstuvwxyz";
+	bld.last_char().append("</p>");
+
+	stringstream out;
+	bld.write(out);
+	assert(out.str() == "<p>abcdefghijklmnopqrstuvwxyz</p>");
+
+	stringstream small_out;
+	small.write(small_out);
+	assert(small_out.str() == "<p>abc");
+
+	//Assigning a grown builder to a builder with the inline buffer.
+	small = bld;
+
+	stringstream copy_out;
+	small.write(copy_out);
+	assert(copy_out.str() == out.str());
+
+	bld.clear();
+	bld << L"x";
+
+	stringstream cleared_out;
+	bld.write(cleared_out);
+	assert(cleared_out.str() == "x");
+}
+
+void markup_builder_decorations() {
+	decoration_id_t shy = DecorationTable::intern("&shy;");
+
+	assert(shy != DecorationTable::NONE);
+	assert(DecorationTable::intern("&shy;") == shy);
+	assert(DecorationTable::intern("<b>") != shy);
+	assert(DecorationTable::get(shy) == "&shy;");
+
+	MarkupBuilder bld;
+
+	bld << L"ab\"";
+	bld[0].append(shy);
+	bld[2].append("</i>");
+
+	//A substitution replaces the char in place even if the char
+	//already has following decorations.
+	bld.substitute(2, 1, "&raquo;");
+
+	stringstream out;
+	bld.write(out);
+	assert(out.str() == "a&shy;b&raquo;</i>");
+
+	//The inline decorations are ordered along with the ones of the table.
+	MarkupBuilder inline_bld;
+
+	inline_bld << L"xy";
+	inline_bld[0].prepend("<b>");
+	inline_bld[0].prepend_inline("<a href='http://example.com/'>");
+	inline_bld[0].prepend("<i>");
+	inline_bld[1].append_inline("</a>");
+	inline_bld[1].append("</i></b>");
+
+	stringstream inline_out;
+	inline_bld.write(inline_out);
+	assert(inline_out.str() == "<i><a href='http://example.com/'><b>xy</a></i></b>");
+
+	//They stay with the chars when the markup is spliced and merged.
+	MarkupBuilder spliced;
+	spliced << inline_bld;
+	spliced[1].append_inline("!");
+
+	stringstream spliced_out;
+	spliced.segment()->write(spliced_out);
+	assert(spliced_out.str() == inline_out.str() + "!");
+}
+
+void markup_builder_escapes() {
+	static const EscapeTable::Escape escapes[] = {
+		{ L'&', "&amp;" },
+		{ L'<', "&lt;" }
+	};
+	EscapeTable table(escapes, 2);
+
+	assert(table.find(L"abcdefgh&", 0, 9) == 8);
+	assert(table.find(L"abcdefghij", 0, 10) == 10);
+
+	MarkupBuilder bld;
+
+	bld << L"<p>";
+	bld.set_escapes(&table);
+	bld << L"a&b<c and some more text & <";
+	bld[5].prepend("<i>");
+	bld[5].append("</i>");
+	bld.substitute(6, 1, "+");
+	bld.set_escapes(NULL);
+	bld << L"</p>";
+
+	stringstream out;
+	bld.write(out);
+	assert(out.str() == "<p>a&amp;<i>b</i>+c and some more text &amp; &lt;</p>");
+
+	//The escapes are kept by the segment of the builder.
+	MarkupBuilder copy;
+	copy << bld;
+
+	stringstream copy_out;
+	copy.write(copy_out);
+	assert(copy_out.str() == out.str());
+}
@@ -4,5 +4,9 @@
 
 void markup_builder_test();
 void markup_builder_merge();
+void markup_builder_splice();
+void markup_builder_growth();
+void markup_builder_decorations();
+void markup_builder_escapes();
 
 #endif /* MARKUP_BUILDER_TEST_HPP_ */
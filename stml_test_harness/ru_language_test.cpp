@@ -48,3 +48,57 @@ void ru_language_test() {
 
     //bld.write(cout);
 }
+
+void ru_language_decorate() {
+    RussianLanguage lang;
+    auto_ptr<Tokenizer> tokenizer(lang.create_tokenizer());
+
+    const char* quotes[QUOTE_TYPES_COUNT] = { NULL, "<<", ">>" };
+    Typography typography(quotes, "--", "|");
+
+    wstring text = L"\"Предсказатель\" - кто-нибудь, двадцать \"якобы\" необъяснимый";
+
+    //The single pass hyphenates the same way as the words found by the tokenizer.
+    MarkupBuilder expected;
+    expected << text.c_str();
+
+    while (tokenizer->next_token(text)) {
+        Tokenizer::Token current_token = tokenizer->get_current_token();
+
+        if (current_token.type == WORD_TOKEN) {
+            lang.hyphenate(expected, current_token.start, current_token.length, "|");
+        }
+    }
+
+    MarkupBuilder bld;
+    bld << text.c_str();
+    lang.decorate(bld, typography, HYPHENATE_WORDS);
+
+    string expected_str;
+    expected.append(expected_str);
+
+    string str;
+    bld.append(str);
+
+    assert(str.compare(0, 2, "<<") == 0);
+    assert(str.find(">> -- ") != string::npos);
+
+    MarkupBuilder plain;
+    plain << text.c_str();
+    const char* no_quotes[QUOTE_TYPES_COUNT] = { NULL };
+    lang.decorate(plain, Typography(no_quotes, "-", "|"), HYPHENATE_WORDS);
+
+    string plain_str;
+    plain.append(plain_str);
+    assert(plain_str == expected_str);
+
+    //Only the parts of the compound word are hyphenated.
+    MarkupBuilder compound;
+    compound << L"двадцать кто-нибудь";
+    lang.decorate(compound, typography, HYPHENATE_COMPOUND_WORDS);
+
+    string compound_str;
+    compound.append(compound_str);
+    assert(compound_str.find("двадцать ") == 0);
+    assert(compound_str.find("ни|будь") != string::npos);
+}
@@ -2,5 +2,6 @@
 #define RU_LANGUAGE_TEST_HPP_
 
 void ru_language_test();
+void ru_language_decorate();
 
 #endif /* RU_LANGUAGE_TEST_HPP_ */
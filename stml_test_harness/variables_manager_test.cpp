@@ -0,0 +1,144 @@
+#include "variables_manager_test.hpp"
+#include "../libstml/include/stml.hpp"
+#include "../libstml/include/variables_manager.hpp"
+
+#include <cassert>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace stml;
+
+void variables_manager_utf8() {
+	VariablesManager var;
+
+	var_id_t id = var.reset(L"test_var", L"знач");
+	assert(var[id].as_utf8() == "\xD0\xB7\xD0\xBD\xD0\xB0\xD1\x87");
+
+	//The cached bytes must follow the changes of the variable.
+	var[id].markup.clear();
+	var[id].markup << L"a";
+	var[id].markup.last_char().append("<br/>");
+	assert(var[id].as_utf8() == "a<br/>");
+
+	MarkupBuilder line;
+	line << L"bc";
+	var[id].markup << line;
+	assert(var[id].as_utf8() == "a<br/>bc");
+
+	VariablesManager::Variable copy(var[id]);
+	assert(copy.as_utf8() == "a<br/>bc");
+}
+
+void variables_manager_lookup() {
+	VariablesManager var;
+
+	//Enough variables to make the index grow several times.
+	for (int i = 0; i < 500; ++i) {
+		wstringstream name;
+		name << L"var_" << i;
+
+		var_id_t id = var.reset(name.str().c_str(), L"");
+		assert(id == (var_id_t)i);
+	}
+
+	for (int i = 0; i < 500; ++i) {
+		wstringstream name;
+		name << L"var_" << i;
+
+		assert(var.get_by_name(name.str().c_str()) == (var_id_t)i);
+		assert(var[name.str()].name == name.str());
+	}
+
+	assert(var.get_by_name(L"var_") == UNKNOWN_VAR);
+	assert(var.get_by_name(L"var_500") == UNKNOWN_VAR);
+
+	//Resetting an existing variable keeps its ID.
+	assert(var.reset(L"var_7", L"y") == 7);
+	assert(var[7].as_boolean());
+	assert(&var[L"var_7"] == &var[7]);
+	assert(&var.get(L"var_7") == &var.get(wstring(L"var_7")));
+
+	bool thrown = false;
+	try {
+		var[L"no_such_var"];
+	} catch (out_of_range&) {
+		thrown = true;
+	}
+	assert(thrown);
+}
+
+void variables_manager_prototype() {
+	VariablesManager prototype;
+
+	var_id_t a = prototype.reset(L"a", L"1");
+	var_id_t b = prototype.reset(L"b", L"2");
+	prototype.freeze();
+
+	VariablesManager doc(prototype);
+	assert(doc.shares_storage_with(prototype));
+
+	//Reading doesn't copy anything.
+	assert(doc.get(a).as_string() == L"1");
+	assert(doc.get(L"b").as_utf8() == "2");
+	assert(doc.shares_storage_with(prototype));
+
+	doc[a].markup << L'0';
+	doc.reset(L"c", L"3");
+
+	assert(!doc.shares_storage_with(prototype));
+	assert(doc.get(a).as_string() == L"10");
+	assert(doc.get(L"c").as_string() == L"3");
+	assert(prototype.get(a).as_string() == L"1");
+	assert(prototype.get_by_name(L"c") == UNKNOWN_VAR);
+
+	//Overrides are parsed once and reused by the documents.
+	istringstream overrides("<$html_p_class>site\n");
+	VariablesManager site = make_prototype(overrides, GENERATOR_HTML);
+
+	for (int i = 0; i < 2; ++i) {
+		istringstream in("Text\n");
+		ostringstream out;
+
+		parse(in, out, GENERATOR_HTML, site);
+		assert(out.str().find("<p class='site' ") != string::npos);
+	}
+}
+
+void variables_manager_views() {
+	VariablesManager var;
+
+	var_id_t al = var.reset(L"al", L"ac");
+	assert(var.get(al).as_alignment() == ALIGN_CENTER);
+
+	//Rewriting the variable invalidates the parsed value.
+	var[al].markup.clear();
+	var[al].markup << L"ar";
+	assert(var.get(al).as_alignment() == ALIGN_RIGHT);
+
+	var_id_t size = var.reset(L"size", L"12pt");
+	assert(var.get(size).as_size().value == 12);
+	assert(var.get(size).as_size().unit == SIZE_PT);
+
+	var.reset(L"size", L"5");
+	assert(var.get(size).as_size().value == 5);
+	assert(var.get(size).as_size().unit == SIZE_PX);
+
+	//A number too long for an int must not overrun the buffer it is read into.
+	var.reset(L"size", L"1234567890123px");
+	assert(var.get(size).as_size().unit == SIZE_PX);
+	assert(var.get(size).as_alignment() == ALIGN_DEFAULT);
+
+	var_id_t fmt = var.reset(L"fmt", L"#./(a-z)");
+	shared_ptr<const ListFormat> format = var.get(fmt).as_list_format();
+	assert(var.get(fmt).as_list_format() == format);
+
+	var[fmt].markup << L"/I.";
+	assert(var.get(fmt).as_list_format() != format);
+
+	//Formats with the same string are parsed once for all variables.
+	VariablesManager other;
+	var_id_t other_fmt = other.reset(L"other_fmt", L"#./(a-z)");
+	assert(other.get(other_fmt).as_list_format() == format);
+}
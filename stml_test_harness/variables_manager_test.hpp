@@ -0,0 +1,9 @@
+#ifndef VARIABLES_MANAGER_TEST_HPP_
+#define VARIABLES_MANAGER_TEST_HPP_
+
+void variables_manager_utf8();
+void variables_manager_lookup();
+void variables_manager_prototype();
+void variables_manager_views();
+
+#endif /* VARIABLES_MANAGER_TEST_HPP_ */